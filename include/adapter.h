@@ -1,10 +1,86 @@
 #ifndef BINDER_INCLUDE_ADAPTER_H
 #define BINDER_INCLUDE_ADAPTER_H
 
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "include/multi.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 namespace binder {
 
+// Converts n values from in to out, as if by C-style casts. The loop is simple
+// enough for the compiler to vectorize for most arithmetic types, and the
+// conversions which SSE2 provides directly are written out below.
+template <typename From, typename To>
+void cast_n(const From* __restrict in, size_t n, To* __restrict out) {
+  if (std::is_same<From, To>::value && std::is_trivially_copyable<To>::value) {
+    std::memcpy((void*)out, (const void*)in, n * sizeof(To));
+    return;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = (To) in[i];
+  }
+}
+#ifdef __SSE2__
+inline void cast_n(const float* __restrict in, size_t n, int32_t* __restrict out) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm_storeu_si128((__m128i*)(out + i), _mm_cvttps_epi32(_mm_loadu_ps(in + i)));
+  }
+  for (; i < n; ++i) {
+    out[i] = (int32_t) in[i];
+  }
+}
+inline void cast_n(const int32_t* __restrict in, size_t n, float* __restrict out) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm_storeu_ps(out + i, _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(in + i))));
+  }
+  for (; i < n; ++i) {
+    out[i] = (float) in[i];
+  }
+}
+inline void cast_n(const double* __restrict in, size_t n, int32_t* __restrict out) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const auto lo = _mm_cvttpd_epi32(_mm_loadu_pd(in + i));
+    const auto hi = _mm_cvttpd_epi32(_mm_loadu_pd(in + i + 2));
+    _mm_storeu_si128((__m128i*)(out + i), _mm_unpacklo_epi64(lo, hi));
+  }
+  for (; i < n; ++i) {
+    out[i] = (int32_t) in[i];
+  }
+}
+inline void cast_n(const int32_t* __restrict in, size_t n, double* __restrict out) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const auto v = _mm_loadu_si128((const __m128i*)(in + i));
+    _mm_storeu_pd(out + i, _mm_cvtepi32_pd(v));
+    _mm_storeu_pd(out + i + 2, _mm_cvtepi32_pd(_mm_srli_si128(v, 8)));
+  }
+  for (; i < n; ++i) {
+    out[i] = (double) in[i];
+  }
+}
+#endif
+
+// Maps may also provide bulk forms of kmap(), vmap() and the ternary vunmap(),
+// which convert n contiguous values at once. AdapterStore uses these for
+// batched gets and puts where they exist.
 template <typename DK, typename DV, typename RK, typename RV>
 struct Cast {
+  typedef typename std::remove_const<DK>::type dk_type;
+  typedef typename std::remove_const<DV>::type dv_type;
+  typedef typename std::remove_const<RK>::type rk_type;
+  typedef typename std::remove_const<RV>::type rv_type;
+
   RK kmap(const DK& dk) {
     return (RK) dk;
   }
@@ -22,6 +98,15 @@ struct Cast {
     (void) rk;
     return (DV) rv;
   } 
+  void kmap_n(const dk_type* dk, size_t n, rk_type* rk) {
+    cast_n(dk, n, rk);
+  }
+  void vmap_n(const dv_type* dv, size_t n, rv_type* rv) {
+    cast_n(dv, n, rv);
+  }
+  void vunmap_n(const dk_type*, const rk_type*, const rv_type* rv, size_t n, dv_type* dv) {
+    cast_n(rv, n, dv);
+  }
 };
 
 template <typename K, typename V, typename S, 
@@ -45,33 +130,29 @@ class AdapterStore {
 
       // CONSTRUCT/COPY/DESTROY:
       private:
-        Iterator(typename S::const_iterator itr) : itr_(itr), val_(nullptr) { }
+        Iterator(typename S::const_iterator itr, M* m) : itr_(itr), m_(m), cached_(false) { }
       public:
-        Iterator() : val_(nullptr) { }
-        Iterator(const Iterator& rhs) : itr_(rhs.itr_), val_(nullptr) { }
-        Iterator(Iterator&& rhs) : Iterator() {
-          swap(rhs);
-        }
-        Iterator& operator=(Iterator rhs) {
-          swap(rhs);
+        Iterator() : m_(nullptr), cached_(false) { }
+        Iterator(const Iterator& rhs) : itr_(rhs.itr_), m_(rhs.m_), cached_(false) { }
+        Iterator& operator=(const Iterator& rhs) {
+          reset();
+          itr_ = rhs.itr_;
+          m_ = rhs.m_;
           return *this;
         }
-        ~Iterator() { 
-          if (val_ != nullptr) {
-            delete val_;
-          }
+        ~Iterator() {
+          reset();
         }
 
         // ABILITIES:
-        reference operator*() {
-          get();
-          return *val_;
+        reference operator*() const {
+          return *get();
         }
-        pointer operator->() {
-          get();
-          return val_;
+        pointer operator->() const {
+          return get();
         }
         Iterator& operator++() {
+          reset();
           ++itr_;
           return *this;
         }
@@ -88,20 +169,27 @@ class AdapterStore {
         }
 
       private:
+        typedef typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type slot_type;
+
         typename S::const_iterator itr_;
-        value_type* val_;
+        M* m_;
+        // The unmapped value at itr_, built on first dereference and kept
+        // until the iterator moves
+        mutable slot_type val_;
+        mutable bool cached_;
 
-        void get() {
-          if (val_ != nullptr) {
-            delete val_;
+        value_type* get() const {
+          if (!cached_) {
+            new (&val_) value_type(m_->kunmap(itr_->first), m_->vunmap(itr_->second));
+            cached_ = true;
           }
-          M m;
-          val_ = new value_type(m.kunmap(itr_->first), m.vunmap(itr_->second));
+          return reinterpret_cast<value_type*>(&val_);
         }
-        void swap(Iterator& rhs) {
-          using std::swap;
-          swap(itr_, rhs.itr_);
-          swap(val_, rhs.val_);
+        void reset() {
+          if (cached_) {
+            reinterpret_cast<value_type*>(&val_)->~value_type();
+            cached_ = false;
+          }
         }
     };
 
@@ -120,7 +208,7 @@ class AdapterStore {
     
     // CONSTRUCT/COPY/DESTROY:
     // Container:
-    AdapterStore(S* s = nullptr) : s_(s) { }
+    AdapterStore(S* s = nullptr, M m = M()) : s_(s), m_(std::move(m)) { }
     AdapterStore(const AdapterStore& rhs) = default;
     AdapterStore(AdapterStore&& rhs) = default;
     AdapterStore& operator=(const AdapterStore& rhs) = default;
@@ -130,22 +218,22 @@ class AdapterStore {
     // ITERATORS:
     // Container:
     iterator begin() {
-      return s_ != nullptr ? iterator(s_->begin()) : iterator();
+      return s_ != nullptr ? iterator(s_->begin(), &m_) : iterator();
     }
     const_iterator begin() const {
-      return s_ != nullptr ? const_iterator(s_->begin()) : const_iterator();
+      return s_ != nullptr ? const_iterator(s_->begin(), &m_) : const_iterator();
     }
     iterator end() {
-      return s_ != nullptr ? iterator(s_->end()) : iterator();
+      return s_ != nullptr ? iterator(s_->end(), &m_) : iterator();
     }
     const_iterator end() const {
-      return s_ != nullptr ? const_iterator(s_->end()) : const_iterator();
+      return s_ != nullptr ? const_iterator(s_->end(), &m_) : const_iterator();
     }
     const_iterator cbegin() const {
-      return s_ != nullptr ? const_iterator(s_->begin()) : const_iterator();
+      return s_ != nullptr ? const_iterator(s_->begin(), &m_) : const_iterator();
     }
     const_iterator cend() const {
-      return s_ != nullptr ? const_iterator(s_->end()) : const_iterator();
+      return s_ != nullptr ? const_iterator(s_->end(), &m_) : const_iterator();
     }
 
     // CAPACITY:
@@ -165,31 +253,30 @@ class AdapterStore {
     void swap(AdapterStore& rhs) {
       using std::swap;
       swap(s_, rhs.s_);
+      swap(m_, rhs.m_);
     }
 
     // STORE INTERFACE:
     // Common:
     bool contains(const k_type& dk) {
-      return s_ != nullptr ? s_->contains(M().kmap(dk)) : false;
+      return s_ != nullptr ? s_->contains(m_.kmap(dk)) : false;
     }
     v_type get(const k_type& dk) {
       if (s_ == nullptr) {
         return v_type();
       }
-      M m;
-      const auto rk = m.kmap(dk);
+      const auto rk = m_.kmap(dk);
       const auto rv = s_->get(rk);
-      return m.vunmap(dk, rk, rv);
+      return m_.vunmap(dk, rk, rv);
     }
     void put(const value_type& v) {
       if (s_ != nullptr) {
-        M m;
-        s_->put(std::make_pair(m.kmap(v.first), m.vmap(v.second)));
+        s_->put(std::make_pair(m_.kmap(v.first), m_.vmap(v.second)));
       }
     }
     void erase(const k_type& dk) {
       if (s_ != nullptr) {
-        s_->erase(M().kmap(dk)); 
+        s_->erase(m_.kmap(dk));
       }
     }
     void clear() {
@@ -197,6 +284,48 @@ class AdapterStore {
         s_->clear();
       }
     }
+    // Batched:
+    template <typename KItr, typename OItr>
+    void multi_contains(KItr begin, KItr end, OItr out) {
+      if (s_ == nullptr) {
+        for (; begin != end; ++begin) {
+          *out++ = false;
+        }
+        return;
+      }
+      const auto rks = kmap(begin, end);
+      binder::multi_contains(*s_, rks.begin(), rks.end(), out);
+    }
+    template <typename KItr, typename OItr>
+    void multi_get(KItr begin, KItr end, OItr out) {
+      if (s_ == nullptr) {
+        for (; begin != end; ++begin) {
+          *out++ = v_type();
+        }
+        return;
+      }
+      const auto rks = kmap(begin, end);
+      std::vector<rv_type> rvs;
+      rvs.reserve(rks.size());
+      binder::multi_get(*s_, rks.begin(), rks.end(), std::back_inserter(rvs));
+      vunmap(begin, end, rks, rvs, out, 0);
+    }
+    template <typename VItr>
+    void multi_put(VItr begin, VItr end) {
+      if (s_ == nullptr) {
+        return;
+      }
+      const auto rvs = map(begin, end, 0);
+      binder::multi_put(*s_, rvs.begin(), rvs.end());
+    }
+    template <typename KItr>
+    void multi_erase(KItr begin, KItr end) {
+      if (s_ == nullptr) {
+        return;
+      }
+      const auto rks = kmap(begin, end);
+      binder::multi_erase(*s_, rks.begin(), rks.end());
+    }
     // AdapterStore:
     S* backing_store(S* s = nullptr) {
       auto ret = s_;
@@ -223,6 +352,89 @@ class AdapterStore {
 
   private:
     S* s_;
+    // Mapping doesn't change what the store holds, so const iterators may
+    // still use a map which keeps state
+    mutable M m_;
+
+    typedef typename std::remove_const<K>::type dk_type;
+    typedef typename std::remove_const<V>::type dv_type;
+    typedef typename std::remove_const<typename S::k_type>::type rk_type;
+    typedef typename std::remove_const<typename S::v_type>::type rv_type;
+
+    // Batched conversions, which use the bulk forms of the map where it
+    // provides them and otherwise convert one element at a time
+    template <typename KItr>
+    std::vector<rk_type> kmap(KItr begin, KItr end) {
+      return kmap(begin, end, 0);
+    }
+    template <typename KItr, typename N = M>
+    auto kmap(KItr begin, KItr end, int)
+        -> decltype(std::declval<N&>().kmap_n((const dk_type*)nullptr, size_t(), (rk_type*)nullptr),
+                    std::vector<rk_type>()) {
+      const std::vector<dk_type> dks(begin, end);
+      std::vector<rk_type> rks(dks.size());
+      m_.kmap_n(dks.data(), dks.size(), rks.data());
+      return rks;
+    }
+    template <typename KItr>
+    std::vector<rk_type> kmap(KItr begin, KItr end, long) {
+      std::vector<rk_type> rks;
+      for (; begin != end; ++begin) {
+        rks.push_back(m_.kmap(*begin));
+      }
+      return rks;
+    }
+    template <typename VItr, typename N = M>
+    auto map(VItr begin, VItr end, int)
+        -> decltype(std::declval<N&>().kmap_n((const dk_type*)nullptr, size_t(), (rk_type*)nullptr),
+                    std::declval<N&>().vmap_n((const dv_type*)nullptr, size_t(), (rv_type*)nullptr),
+                    std::vector<typename S::value_type>()) {
+      std::vector<dk_type> dks;
+      std::vector<dv_type> dvs;
+      for (; begin != end; ++begin) {
+        dks.push_back(begin->first);
+        dvs.push_back(begin->second);
+      }
+      std::vector<rk_type> rks(dks.size());
+      std::vector<rv_type> rvs(dvs.size());
+      m_.kmap_n(dks.data(), dks.size(), rks.data());
+      m_.vmap_n(dvs.data(), dvs.size(), rvs.data());
+
+      std::vector<typename S::value_type> res;
+      res.reserve(rks.size());
+      for (size_t i = 0, ie = rks.size(); i < ie; ++i) {
+        res.emplace_back(rks[i], rvs[i]);
+      }
+      return res;
+    }
+    template <typename VItr>
+    std::vector<typename S::value_type> map(VItr begin, VItr end, long) {
+      std::vector<typename S::value_type> res;
+      for (; begin != end; ++begin) {
+        res.push_back(std::make_pair(m_.kmap(begin->first), m_.vmap(begin->second)));
+      }
+      return res;
+    }
+    template <typename KItr, typename OItr, typename N = M>
+    auto vunmap(KItr begin, KItr end, const std::vector<rk_type>& rks,
+                const std::vector<rv_type>& rvs, OItr out, int)
+        -> decltype(std::declval<N&>().vunmap_n((const dk_type*)nullptr, (const rk_type*)nullptr,
+                                                (const rv_type*)nullptr, size_t(), (dv_type*)nullptr),
+                    void()) {
+      const std::vector<dk_type> dks(begin, end);
+      std::vector<dv_type> dvs(dks.size());
+      m_.vunmap_n(dks.data(), rks.data(), rvs.data(), dks.size(), dvs.data());
+      for (const auto& dv : dvs) {
+        *out++ = dv;
+      }
+    }
+    template <typename KItr, typename OItr>
+    void vunmap(KItr begin, KItr, const std::vector<rk_type>& rks,
+                const std::vector<rv_type>& rvs, OItr out, long) {
+      for (size_t i = 0, ie = rks.size(); i < ie; ++i, ++begin) {
+        *out++ = m_.vunmap(*begin, rks[i], rvs[i]);
+      }
+    }
 };
 
 } // namespace binder
@@ -0,0 +1,137 @@
+#ifndef BINDER_INCLUDE_ADMIT_H
+#define BINDER_INCLUDE_ADMIT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <vector>
+
+namespace binder {
+
+template <typename S>
+struct AdmitAll {
+  void record(const typename S::k_type&) {
+    // Does nothing.
+  }
+  bool admit(const typename S::k_type&, const typename S::k_type&) {
+    return true;
+  }
+  friend void swap(AdmitAll&, AdmitAll&) {
+    // Does nothing.
+  }
+};
+
+// TinyLFU admission (Einziger, Friedman and Manes). Accesses are counted in a
+// count-min sketch of four rows of 4-bit counters, and a new key is only
+// admitted if it has been seen more often than the key it would evict. A
+// doorkeeper Bloom filter absorbs the first access to each key, so that keys
+// seen once never reach the sketch. Every 10 accesses per counter, all
+// counters are halved and the doorkeeper is cleared, so that frequencies
+// reflect recent history.
+template <typename S, typename H = std::hash<typename std::remove_const<typename S::k_type>::type>>
+class TinyLfu {
+  public:
+    // Tracks the frequencies of about n keys, which should be at least the
+    // capacity of the cache
+    explicit TinyLfu(size_t n = 1 << 14) : additions_(0) {
+      size_t width = 64;
+      while (width < n) {
+        width <<= 1;
+      }
+      mask_ = width - 1;
+      sample_ = 10 * width;
+      table_.resize(ROWS * width / 16);
+      door_.resize(2 * width / 64);
+    }
+
+    void record(const typename S::k_type& k) {
+      const auto h = hash(k);
+      if (door(h)) {
+        for (size_t i = 0; i < ROWS; ++i) {
+          const auto j = index(h, i);
+          auto& w = table_[i * (mask_+1) / 16 + j / 16];
+          const auto shift = (j % 16) * 4;
+          if (((w >> shift) & 0xf) != 0xf) {
+            w += uint64_t(1) << shift;
+          }
+        }
+      } else {
+        for (size_t i = 0; i < 2; ++i) {
+          const auto j = index(h, i) + i * (mask_+1);
+          door_[j / 64] |= uint64_t(1) << (j % 64);
+        }
+      }
+      if (++additions_ == sample_) {
+        reset();
+      }
+    }
+    bool admit(const typename S::k_type& candidate, const typename S::k_type& victim) {
+      return frequency(candidate) > frequency(victim);
+    }
+    // An estimate of the number of recent accesses to k
+    size_t frequency(const typename S::k_type& k) const {
+      const auto h = hash(k);
+      size_t f = 15;
+      for (size_t i = 0; i < ROWS; ++i) {
+        const auto j = index(h, i);
+        const auto w = table_[i * (mask_+1) / 16 + j / 16];
+        f = std::min<size_t>(f, (w >> ((j % 16) * 4)) & 0xf);
+      }
+      return f + (door(h) ? 1 : 0);
+    }
+    friend void swap(TinyLfu& lhs, TinyLfu& rhs) {
+      using std::swap;
+      swap(lhs.table_, rhs.table_);
+      swap(lhs.door_, rhs.door_);
+      swap(lhs.mask_, rhs.mask_);
+      swap(lhs.additions_, rhs.additions_);
+      swap(lhs.sample_, rhs.sample_);
+    }
+
+  private:
+    static const size_t ROWS = 4;
+
+    // Rows of 16 counters per word, and a doorkeeper of two bits per counter
+    std::vector<uint64_t> table_;
+    std::vector<uint64_t> door_;
+    size_t mask_;
+    size_t additions_;
+    size_t sample_;
+
+    static uint64_t hash(const typename S::k_type& k) {
+      // std::hash is the identity for integers, so mix before splitting
+      uint64_t h = H()(k);
+      h ^= h >> 33;
+      h *= 0xff51afd7ed558ccdull;
+      h ^= h >> 33;
+      h *= 0xc4ceb9fe1a85ec53ull;
+      h ^= h >> 33;
+      return h;
+    }
+    // The counter in row i, derived from two halves of h
+    size_t index(uint64_t h, size_t i) const {
+      return (uint32_t(h) + i * ((h >> 32) | 1)) & mask_;
+    }
+    bool door(uint64_t h) const {
+      for (size_t i = 0; i < 2; ++i) {
+        const auto j = index(h, i) + i * (mask_+1);
+        if ((door_[j / 64] & (uint64_t(1) << (j % 64))) == 0) {
+          return false;
+        }
+      }
+      return true;
+    }
+    // Halves every counter and clears the doorkeeper
+    void reset() {
+      for (auto& w : table_) {
+        w = (w >> 1) & 0x7777777777777777ull;
+      }
+      std::fill(door_.begin(), door_.end(), 0);
+      additions_ /= 2;
+    }
+};
+
+} // namespace binder
+
+#endif
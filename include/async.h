@@ -0,0 +1,339 @@
+#ifndef BINDER_INCLUDE_ASYNC_H
+#define BINDER_INCLUDE_ASYNC_H
+
+#include <hiredis/async.h>
+#include <hiredis/hiredis.h>
+#include <poll.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+#endif
+#include "include/redis.h"
+
+namespace binder {
+
+template <typename K, typename V, typename IO = Stream<K,V>>
+class AsyncRedisStore {
+  private:
+    // A command awaiting its reply, which is null if the command failed
+    struct Op {
+      std::vector<std::string> args;
+      virtual ~Op() = default;
+      virtual void done(redisReply* rep) = 0;
+    };
+    template <typename F>
+    struct FnOp : Op {
+      F f;
+      FnOp(F&& fn) : f(std::move(fn)) { }
+      void done(redisReply* rep) override {
+        f(rep);
+      }
+    };
+
+  public:
+#if defined(__cpp_impl_coroutine)
+    template <typename T>
+    class Awaitable {
+      friend class AsyncRedisStore;
+
+      // CONSTRUCT/COPY/DESTROY:
+      private:
+        Awaitable(AsyncRedisStore* rs, std::vector<std::string>&& args, T (*decode)(redisReply*)) :
+            rs_(rs), args_(std::move(args)), decode_(decode) { }
+
+      // AWAITABLE INTERFACE:
+      public:
+        bool await_ready() const {
+          return false;
+        }
+        // The reply may arrive before submit returns, on this thread when the
+        // store is disconnected. Whichever side finishes second resumes, so
+        // the coroutine is never resumed inside its own await_suspend.
+        bool await_suspend(std::coroutine_handle<> h) {
+          h_ = h;
+          rs_->submit(std::move(args_), [this](redisReply* rep) {
+            res_ = decode_(rep);
+            if (done_.exchange(true)) {
+              h_.resume();
+            }
+          });
+          return !done_.exchange(true);
+        }
+        T await_resume() {
+          return std::move(res_);
+        }
+
+      private:
+        AsyncRedisStore* rs_;
+        std::vector<std::string> args_;
+        T (*decode_)(redisReply*);
+        T res_;
+        std::coroutine_handle<> h_;
+        std::atomic<bool> done_{false};
+    };
+#endif
+
+    // TYPES:
+    typedef std::pair<const K, const V> value_type;
+    typedef const K k_type;
+    typedef const V v_type;
+
+    // CONSTRUCT/COPY/DESTROY:
+    AsyncRedisStore() : ac_(nullptr), connected_(false), running_(false) { }
+    AsyncRedisStore(const std::string& host, unsigned int port) : AsyncRedisStore() {
+      connect(host, port);
+    }
+    AsyncRedisStore(const AsyncRedisStore& rhs) = delete;
+    AsyncRedisStore& operator=(const AsyncRedisStore& rhs) = delete;
+    ~AsyncRedisStore() {
+      disconnect();
+    }
+
+    // ASYNC STORE INTERFACE:
+    // Futures are fulfilled on the event loop thread. A disconnected store
+    // fulfills them immediately with default values.
+    std::future<bool> contains_async(const k_type& k) {
+      return request({"EXISTS", codec::kstr(k)}, &exists);
+    }
+    std::future<V> get_async(const k_type& k) {
+      return request({"GET", codec::kstr(k)}, &value);
+    }
+    std::future<bool> put_async(const value_type& v) {
+      return request({"SET", codec::kstr(v.first), codec::vstr(v.second)}, &ok);
+    }
+    std::future<bool> erase_async(const k_type& k) {
+      return request({"DEL", codec::kstr(k)}, &ok);
+    }
+#if defined(__cpp_impl_coroutine)
+    // Awaiting coroutines are resumed on the event loop thread, and so must
+    // not block on other requests before suspending again.
+    Awaitable<bool> co_contains(const k_type& k) {
+      return Awaitable<bool>(this, {"EXISTS", codec::kstr(k)}, &exists);
+    }
+    Awaitable<V> co_get(const k_type& k) {
+      return Awaitable<V>(this, {"GET", codec::kstr(k)}, &value);
+    }
+    Awaitable<bool> co_put(const value_type& v) {
+      return Awaitable<bool>(this, {"SET", codec::kstr(v.first), codec::vstr(v.second)}, &ok);
+    }
+    Awaitable<bool> co_erase(const k_type& k) {
+      return Awaitable<bool>(this, {"DEL", codec::kstr(k)}, &ok);
+    }
+#endif
+    // AsyncRedisStore:
+    void connect(const std::string& host, unsigned int port) {
+      disconnect();
+      if (pipe(wake_) != 0) {
+        return;
+      }
+      ac_ = redisAsyncConnect(host.c_str(), port);
+      if (ac_ == nullptr || ac_->err) {
+        if (ac_ != nullptr) {
+          redisAsyncFree(ac_);
+          ac_ = nullptr;
+        }
+        close_pipe();
+        return;
+      }
+
+      // The event hooks must be in place before the connect callback is set,
+      // since that's when hiredis first asks to wait for writability
+      reading_ = false;
+      writing_ = false;
+      ac_->data = this;
+      ac_->ev.data = this;
+      ac_->ev.addRead = [](void* d) { ((AsyncRedisStore*)d)->reading_ = true; };
+      ac_->ev.delRead = [](void* d) { ((AsyncRedisStore*)d)->reading_ = false; };
+      ac_->ev.addWrite = [](void* d) { ((AsyncRedisStore*)d)->writing_ = true; };
+      ac_->ev.delWrite = [](void* d) { ((AsyncRedisStore*)d)->writing_ = false; };
+      ac_->ev.cleanup = [](void* d) {
+        ((AsyncRedisStore*)d)->reading_ = false;
+        ((AsyncRedisStore*)d)->writing_ = false;
+      };
+      redisAsyncSetDisconnectCallback(ac_, &on_disconnect);
+      redisAsyncSetConnectCallback(ac_, &on_connect);
+
+      running_ = true;
+      connecting_ = std::promise<bool>();
+      auto connected = connecting_.get_future();
+      loop_ = std::thread(&AsyncRedisStore::run, this);
+      if (connected.wait_for(std::chrono::milliseconds(1500)) != std::future_status::ready || !connected.get()) {
+        disconnect();
+      }
+    }
+    bool is_connected() const {
+      return connected_;
+    }
+    // Requests which are still outstanding are failed
+    void disconnect() {
+      if (!loop_.joinable()) {
+        return;
+      }
+      {
+        std::lock_guard<std::mutex> lock(m_);
+        running_ = false;
+      }
+      wake();
+      loop_.join();
+      close_pipe();
+    }
+
+  private:
+    typedef RedisCodec<K,V,IO> codec;
+
+    // Owned by the event loop thread once it has started
+    redisAsyncContext* ac_;
+    bool reading_;
+    bool writing_;
+    std::promise<bool> connecting_;
+
+    std::thread loop_;
+    int wake_[2];
+    std::atomic<bool> connected_;
+    std::mutex m_;
+    bool running_;
+    std::vector<Op*> queue_;
+
+    static bool exists(redisReply* rep) {
+      return rep != nullptr && rep->type == REDIS_REPLY_INTEGER && rep->integer == 1;
+    }
+    static V value(redisReply* rep) {
+      return codec::vread(rep);
+    }
+    static bool ok(redisReply* rep) {
+      return rep != nullptr && rep->type != REDIS_REPLY_ERROR;
+    }
+
+    template <typename T>
+    std::future<T> request(std::vector<std::string>&& args, T (*decode)(redisReply*)) {
+      std::promise<T> p;
+      auto res = p.get_future();
+      submit(std::move(args), [p = std::move(p), decode](redisReply* rep) mutable {
+        p.set_value(decode(rep));
+      });
+      return res;
+    }
+    template <typename F>
+    void submit(std::vector<std::string>&& args, F&& f) {
+      auto op = new FnOp<typename std::decay<F>::type>(std::forward<F>(f));
+      op->args = std::move(args);
+
+      std::unique_lock<std::mutex> lock(m_);
+      if (!running_ || !connected_) {
+        lock.unlock();
+        op->done(nullptr);
+        delete op;
+        return;
+      }
+      // The loop drains the whole queue, so it only needs waking once
+      queue_.push_back(op);
+      if (queue_.size() == 1) {
+        lock.unlock();
+        wake();
+      }
+    }
+
+    void wake() {
+      const char c = 0;
+      (void) !write(wake_[1], &c, 1);
+    }
+    void close_pipe() {
+      close(wake_[0]);
+      close(wake_[1]);
+    }
+
+    static void on_connect(const redisAsyncContext* ac, int status) {
+      auto rs = (AsyncRedisStore*)ac->data;
+      rs->connected_ = status == REDIS_OK;
+      // hiredis frees the context after a failed connect
+      if (status != REDIS_OK) {
+        rs->ac_ = nullptr;
+      }
+      rs->connecting_.set_value(status == REDIS_OK);
+    }
+    static void on_disconnect(const redisAsyncContext* ac, int status) {
+      (void) status;
+      auto rs = (AsyncRedisStore*)ac->data;
+      rs->connected_ = false;
+      // hiredis frees the context once this callback returns
+      rs->ac_ = nullptr;
+    }
+    static void on_reply(redisAsyncContext* ac, void* rep, void* data) {
+      (void) ac;
+      auto op = (Op*)data;
+      op->done((redisReply*)rep);
+      delete op;
+    }
+
+    void run() {
+      std::vector<Op*> ops;
+      std::vector<const char*> argv;
+      std::vector<size_t> lens;
+      while (true) {
+        pollfd fds[2] = {{wake_[0], POLLIN, 0}, {-1, 0, 0}};
+        if (ac_ != nullptr) {
+          fds[1].fd = ac_->c.fd;
+          fds[1].events = (reading_ ? POLLIN : 0) | (writing_ ? POLLOUT : 0);
+        }
+        if (poll(fds, 2, -1) < 0) {
+          continue;
+        }
+
+        if (fds[0].revents & POLLIN) {
+          char buf[64];
+          (void) !read(wake_[0], buf, sizeof(buf));
+          std::lock_guard<std::mutex> lock(m_);
+          if (!running_) {
+            break;
+          }
+          ops.swap(queue_);
+        }
+        for (auto op : ops) {
+          argv.clear();
+          lens.clear();
+          for (const auto& a : op->args) {
+            argv.push_back(a.c_str());
+            lens.push_back(a.length());
+          }
+          if (ac_ == nullptr ||
+              redisAsyncCommandArgv(ac_, &on_reply, op, argv.size(), argv.data(), lens.data()) != REDIS_OK) {
+            op->done(nullptr);
+            delete op;
+          }
+        }
+        ops.clear();
+
+        if (ac_ != nullptr && (fds[1].revents & (POLLIN | POLLERR | POLLHUP))) {
+          redisAsyncHandleRead(ac_);
+        }
+        if (ac_ != nullptr && (fds[1].revents & POLLOUT)) {
+          redisAsyncHandleWrite(ac_);
+        }
+      }
+
+      // Fails every outstanding and queued request
+      if (ac_ != nullptr) {
+        redisAsyncFree(ac_);
+        ac_ = nullptr;
+      }
+      connected_ = false;
+      for (auto op : queue_) {
+        op->done(nullptr);
+        delete op;
+      }
+      queue_.clear();
+    }
+};
+
+} // namespace binder
+
+#endif
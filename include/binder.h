@@ -2,11 +2,25 @@
 #define BINDER_INCLUDE_BINDER_H
 
 #include "include/adapter.h"
+#include "include/admit.h"
+#include "include/async.h"
 #include "include/cache.h"
+#include "include/codec.h"
+#include "include/concurrent.h"
 #include "include/evict.h"
+#include "include/flat.h"
+#include "include/fused.h"
+#include "include/log.h"
+#include "include/mmap.h"
+#include "include/multi.h"
+#include "include/near.h"
+#include "include/pool.h"
 #include "include/read.h"
 #include "include/redis.h"
+#include "include/ring.h"
+#include "include/sharded.h"
 #include "include/store.h"
+#include "include/weigh.h"
 #include "include/write.h"
 
 #endif
@@ -1,8 +1,17 @@
 #ifndef BINDER_INCLUDE_CACHE_H
 #define BINDER_INCLUDE_CACHE_H
 
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "include/admit.h"
 #include "include/evict.h"
+#include "include/multi.h"
 #include "include/read.h"
+#include "include/weigh.h"
 #include "include/write.h"
 
 namespace binder {
@@ -10,7 +19,9 @@ namespace binder {
 template <typename S1, typename S2,
           typename E = Lru<S1>, 
           typename R = Fetch<S2>, 
-          typename W = WriteThrough<S2>>
+          typename W = WriteThrough<S2>,
+          typename A = AdmitAll<S1>,
+          typename G = Unit<S1>>
 class Cache {
   public:
     // TYPES:
@@ -28,7 +39,7 @@ class Cache {
     
     // CONSTRUCT/COPY/DESTROY:
     // Container:
-    Cache(S1* s1 = nullptr, S2* s2 = nullptr, size_t c = 16) : s1_(s1), s2_(s2), capacity_(c) { }
+    Cache(S1* s1 = nullptr, S2* s2 = nullptr, size_t c = 16) : s1_(s1), s2_(s2), capacity_(c), low_(std::numeric_limits<size_t>::max()), weight_(0) { }
     Cache(const Cache& rhs) = default;
     Cache(Cache&& rhs) = default;
     Cache& operator=(const Cache& rhs) = default;
@@ -75,9 +86,14 @@ class Cache {
       swap(s1_, rhs.s1_);
       swap(s2_, rhs.s2_);
       swap(capacity_, rhs.capacity_);
+      swap(low_, rhs.low_);
       swap(e_, rhs.e_);
       swap(r_, rhs.r_);
       swap(w_, rhs.w_);
+      swap(a_, rhs.a_);
+      swap(g_, rhs.g_);
+      swap(weights_, rhs.weights_);
+      swap(weight_, rhs.weight_);
     }
 
     // STORE INTERFACE:
@@ -89,39 +105,140 @@ class Cache {
       if (s1_ == nullptr || s2_ == nullptr) {
         return v_type();
       }
+      a_.record(k);
       if (s1_->contains(k)) {
         e_.touch(k);
-      } else if (s2_ != nullptr) {
-        r_.fetch(*s2_, k);
-        for (auto v = r_.begin(), ve = r_.end(); v != ve; ++v) {
-          put(*v);
+        return s1_->get(k);
+      }
+
+      // The write policy may still hold a newer value than s2
+      typename std::remove_const<v_type>::type q;
+      if (binder::queued(w_, k, q)) {
+        place(value_type(k, q));
+        admit(k);
+        return q;
+      }
+
+      // The admission policy may turn k away, so read it from the fetch
+      r_.fetch(*s2_, k);
+      fill();
+      for (auto v = r_.begin(), ve = r_.end(); v != ve; ++v) {
+        if (v->first == k) {
+          return v->second;
         }
       }
-      return s1_->get(k);
+      return v_type();
     }
     void put(const value_type& v) {
       if (s1_ != nullptr && s2_ != nullptr) {
-        s1_->put(v);
-        e_.touch(v.first);
+        a_.record(v.first);
+        invalidate(r_, v.first);
+        place(v);
         w_.modify(*s2_, v);
-        resize(max_size());
+        admit(v.first);
       }
     }
     void erase(const k_type& k) {
       if (s1_ != nullptr && s2_ != nullptr) {
         w_.flush(*s2_, k);
         e_.erase(k);
+        unweigh(k);
         s1_->erase(k);
       }
     }
     void clear() { 
       resize(0);
     }
+    // Batched:
+    template <typename KItr, typename OItr>
+    void multi_get(KItr begin, KItr end, OItr out) {
+      if (s1_ == nullptr || s2_ == nullptr) {
+        for (; begin != end; ++begin) {
+          *out++ = v_type();
+        }
+        return;
+      }
+
+      // Serve hits and values still queued by the write policy immediately,
+      // and collect misses for one batched fetch
+      std::vector<typename std::remove_const<v_type>::type> vs;
+      std::vector<typename std::remove_const<k_type>::type> misses;
+      std::vector<size_t> idx;
+      typename std::remove_const<v_type>::type q;
+      for (auto k = begin; k != end; ++k) {
+        a_.record(*k);
+        if (s1_->contains(*k)) {
+          e_.touch(*k);
+          vs.push_back(s1_->get(*k));
+        } else if (binder::queued(w_, *k, q)) {
+          vs.push_back(q);
+          place(value_type(*k, q));
+          admit(*k);
+        } else {
+          idx.push_back(vs.size());
+          misses.push_back(*k);
+          vs.push_back(v_type());
+        }
+      }
+      if (!misses.empty()) {
+        r_.fetch(*s2_, misses.begin(), misses.end());
+        fill();
+
+        // Results are read from the fetch rather than from s1, which may
+        // already have evicted them if the batch exceeds capacity
+        match(r_.begin(), r_.end(), misses.begin(), misses.end(), [&](size_t i, const v_type& v) {
+          vs[idx[i]] = v;
+        });
+      }
+
+      for (const auto& v : vs) {
+        *out++ = v;
+      }
+    }
+    template <typename VItr>
+    void multi_put(VItr begin, VItr end) {
+      if (s1_ != nullptr && s2_ != nullptr) {
+        // Keys turned away by the admission policy are flushed as they are
+        // erased, so the write policy must see them first
+        w_.modify(*s2_, begin, end);
+        for (auto v = begin; v != end; ++v) {
+          a_.record(v->first);
+          invalidate(r_, v->first);
+          place(*v);
+          admit(v->first);
+        }
+      }
+    }
+    template <typename KItr>
+    void multi_erase(KItr begin, KItr end) {
+      if (s1_ != nullptr && s2_ != nullptr) {
+        w_.flush(*s2_, begin, end);
+        for (; begin != end; ++begin) {
+          if (s1_->contains(*begin)) {
+            e_.erase(*begin);
+            unweigh(*begin);
+            s1_->erase(*begin);
+          }
+        }
+      }
+    }
     // Cache:
+    // The total weight of the entries in the primary store, which is kept
+    // within capacity
+    size_t weight() const {
+      return unit ? size() : weight_;
+    }
     void capacity(size_t c) {
       capacity_ = c;
       resize(max_size());
     }
+    // Once the weight exceeds capacity, evicts down to low rather than just
+    // back within capacity, so that victims are flushed and erased in batches
+    // rather than one per put. By default low is the capacity.
+    void watermark(size_t low) {
+      low_ = low;
+      resize(max_size());
+    }
     S1* primary_store(S1* s1 = nullptr) {
       auto ret = s1_;
       if (s1 != nullptr) {
@@ -158,13 +275,98 @@ class Cache {
     S1* s1_;
     S2* s2_;
     size_t capacity_;
+    size_t low_;
     E e_;
     R r_;
     W w_;
+    A a_;
+    G g_;
+    // The weight of each entry, unless every entry weighs one
+    static constexpr bool unit = std::is_same<G, Unit<S1>>::value;
+    std::unordered_map<typename std::remove_const<k_type>::type, size_t> weights_;
+    size_t weight_;
 
+    // Moves the results of the last fetch into s1. These values are already
+    // in s2, so they bypass the write policy.
+    void fill() {
+      for (auto v = r_.begin(), ve = r_.end(); v != ve; ++v) {
+        place(*v);
+        admit(v->first);
+      }
+    }
+    // Makes room for k, which has just been put into s1, unless the admission
+    // policy would rather keep the eviction victim, in which case k goes. The
+    // victim is only peeked at until then, so a rejection leaves the evict
+    // policy as it was.
+    void admit(const k_type& k) {
+      if (weight() > max_size()) {
+        const auto v = binder::peek(e_);
+        if (v == k || a_.admit(k, v)) {
+          evict(binder::evict(e_, v), std::min(low_, max_size()));
+        } else {
+          erase(k);
+        }
+      }
+      resize(max_size());
+    }
+    // Evicts down to the low watermark once the weight exceeds s, or
+    // everything if s is 0
     void resize(size_t s) {
-      while (size() > s) {
-        erase(e_.evict());
+      if (s1_ != nullptr && s2_ != nullptr && !empty() && (s == 0 || weight() > s)) {
+        evict(e_.evict(), std::min(low_, s));
+      }
+    }
+    // Evicts v, which the evict policy has just selected, and then further
+    // victims until the weight is within low. Victims are flushed to s2 and
+    // erased from s1 in one batch each.
+    void evict(const k_type& v, size_t low) {
+      std::vector<typename std::remove_const<k_type>::type> victims(1, v);
+      auto n = size();
+      auto w = weight();
+      for (;;) {
+        e_.erase(victims.back());
+        w -= unit ? 1 : weights_[victims.back()];
+        if (--n == 0 || (low != 0 && w <= low)) {
+          break;
+        }
+        victims.push_back(e_.evict());
+      }
+      w_.flush(*s2_, victims.begin(), victims.end());
+      for (const auto& k : victims) {
+        unweigh(k);
+      }
+      binder::multi_erase(*s1_, victims.begin(), victims.end());
+    }
+    // Puts v into s1 and records its weight. The primary store may keep an
+    // existing value rather than replace it, so a weighed key is erased first
+    // and the weight is always that of the value s1 holds.
+    void place(const value_type& v) {
+      if (!unit) {
+        auto itr = weights_.find(v.first);
+        if (itr != weights_.end()) {
+          weight_ -= itr->second;
+          weights_.erase(itr);
+          s1_->erase(v.first);
+        }
+      }
+      s1_->put(v);
+      touch(e_, v.first, weigh(v));
+    }
+    size_t weigh(const value_type& v) {
+      const auto w = g_(v);
+      if (!unit) {
+        weights_.emplace(v.first, w);
+        weight_ += w;
+      }
+      return w;
+    }
+    void unweigh(const k_type& k) {
+      if (!unit) {
+        auto itr = weights_.find(k);
+        if (itr != weights_.end()) {
+          weight_ -= itr->second;
+          weights_.erase(itr);
+        }
       }
     }
 };
@@ -0,0 +1,159 @@
+#ifndef BINDER_INCLUDE_CODEC_H
+#define BINDER_INCLUDE_CODEC_H
+
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include "ext/stl/include/buf_stream.h"
+
+namespace binder {
+
+template <typename K, typename V>
+struct Stream {
+  void kread(std::istream& is, K& k) {
+    is >> k;
+  }
+  void vread(std::istream& is, V& v) {
+    is >> v;
+  }
+  void kwrite(std::ostream& os, const K& k) {
+    os << k;
+  }
+  void vwrite(std::ostream& os, const V& v) {
+    os << v;
+  }
+};
+
+// Encodes trivially copyable types as their raw bytes and strings as their
+// contents. Other types fall back on the iostream operators. Unlike Stream,
+// Binary writes into a caller-provided buffer and reads directly from the
+// bytes of a reply, so neither direction allocates for trivially copyable
+// types. Decoding a string allocates unless it fits in the string itself,
+// and the iostream fallback allocates in both directions.
+template <typename T, typename Enable = void>
+struct BinaryCodec {
+  static void write(std::string& buf, const T& t) {
+    std::ostringstream os;
+    os << t;
+    buf = os.str();
+  }
+  static void read(const char* begin, const char* end, T& t) {
+    stl::buf_stream bs(begin, end);
+    bs >> t;
+  }
+};
+template <typename T>
+struct BinaryCodec<T, typename std::enable_if<std::is_trivially_copyable<T>::value>::type> {
+  static void write(std::string& buf, const T& t) {
+    buf.assign((const char*)&t, sizeof(T));
+  }
+  static void read(const char* begin, const char* end, T& t) {
+    if (end - begin == (ptrdiff_t)sizeof(T)) {
+      memcpy((void*)&t, begin, sizeof(T));
+    }
+  }
+};
+template <>
+struct BinaryCodec<std::string> {
+  static void write(std::string& buf, const std::string& t) {
+    buf.assign(t);
+  }
+  static void read(const char* begin, const char* end, std::string& t) {
+    t.assign(begin, end);
+  }
+};
+
+template <typename K, typename V>
+struct Binary {
+  void kread(const char* begin, const char* end, K& k) {
+    BinaryCodec<K>::read(begin, end, k);
+  }
+  void vread(const char* begin, const char* end, V& v) {
+    BinaryCodec<V>::read(begin, end, v);
+  }
+  void kwrite(std::string& buf, const K& k) {
+    BinaryCodec<K>::write(buf, k);
+  }
+  void vwrite(std::string& buf, const V& v) {
+    BinaryCodec<V>::write(buf, v);
+  }
+};
+
+// Converts keys and values to and from strings of bytes, using either an IO
+// policy which reads and writes streams (like Stream) or one which reads and
+// writes buffers (like Binary)
+template <typename K, typename V, typename IO>
+struct Codec {
+  static void kwrite(std::string& buf, const K& k) {
+    kwrite(buf, k, 0);
+  }
+  static void vwrite(std::string& buf, const V& v) {
+    vwrite(buf, v, 0);
+  }
+  static std::string kstr(const K& k) {
+    std::string buf;
+    kwrite(buf, k);
+    return buf;
+  }
+  static std::string vstr(const V& v) {
+    std::string buf;
+    vwrite(buf, v);
+    return buf;
+  }
+  static K kread(const char* str, size_t len) {
+    K k = K();
+    kread(str, str+len, k, 0);
+    return k;
+  }
+  static V vread(const char* str, size_t len) {
+    V v = V();
+    vread(str, str+len, v, 0);
+    return v;
+  }
+
+  private:
+    template <typename I = IO>
+    static auto kwrite(std::string& buf, const K& k, int)
+        -> decltype(I().kwrite(buf, k), void()) {
+      I().kwrite(buf, k);
+    }
+    static void kwrite(std::string& buf, const K& k, long) {
+      std::ostringstream os;
+      IO().kwrite(os, k);
+      buf = os.str();
+    }
+    template <typename I = IO>
+    static auto vwrite(std::string& buf, const V& v, int)
+        -> decltype(I().vwrite(buf, v), void()) {
+      I().vwrite(buf, v);
+    }
+    static void vwrite(std::string& buf, const V& v, long) {
+      std::ostringstream os;
+      IO().vwrite(os, v);
+      buf = os.str();
+    }
+    template <typename I = IO>
+    static auto kread(const char* begin, const char* end, K& k, int)
+        -> decltype(I().kread(begin, end, k), void()) {
+      I().kread(begin, end, k);
+    }
+    static void kread(const char* begin, const char* end, K& k, long) {
+      stl::buf_stream bs(begin, end);
+      IO().kread(bs, k);
+    }
+    template <typename I = IO>
+    static auto vread(const char* begin, const char* end, V& v, int)
+        -> decltype(I().vread(begin, end, v), void()) {
+      I().vread(begin, end, v);
+    }
+    static void vread(const char* begin, const char* end, V& v, long) {
+      stl::buf_stream bs(begin, end);
+      IO().vread(bs, v);
+    }
+};
+
+} // namespace binder
+
+#endif
@@ -0,0 +1,605 @@
+#ifndef BINDER_INCLUDE_CONCURRENT_H
+#define BINDER_INCLUDE_CONCURRENT_H
+
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "include/evict.h"
+#include "include/read.h"
+#include "include/write.h"
+
+namespace binder {
+
+// A Cache which may be shared between threads. Keys are partitioned between
+// shards, each of which owns its own primary store, evict, read and write
+// policies, and a share of the capacity. A shard's primary store and evict policy are
+// guarded by one lock, which is only ever held for in-memory work, so hits on
+// different shards never contend and hits never wait on the backing store.
+// Misses and writes to a shard are ordered by a second lock, which is held
+// while the backing store is accessed. The backing store must itself be safe
+// to use from several threads at once.
+//
+// Concurrent misses on the same key are coalesced: the first performs the
+// fetch, and the others wait for its result rather than each reading the
+// backing store.
+template <typename S1, typename S2,
+          typename E = Lru<S1>,
+          typename R = Fetch<S2>,
+          typename W = WriteThrough<S2>,
+          typename H = std::hash<typename std::remove_const<typename S1::k_type>::type>>
+class ConcurrentCache {
+  private:
+    typedef typename std::remove_const<typename S1::k_type>::type key_type;
+    typedef typename std::remove_const<typename S1::v_type>::type val_type;
+
+    // Padded so that neighboring locks never share a cache line
+    struct Shard {
+      // Guards s1, e, flights and coalesced
+      mutable std::mutex m;
+      S1 s1;
+      E e;
+      size_t capacity;
+      // The results of fetches in progress, and how many gets have waited on
+      // one rather than fetching
+      std::unordered_map<key_type, std::shared_future<val_type>, H> flights;
+      size_t coalesced = 0;
+      // Guards r and w and orders access to s2 for the shard's keys. Taken
+      // before m.
+      mutable std::mutex wm;
+      R r;
+      W w;
+      char pad[64];
+    };
+
+  public:
+    template <bool is_const>
+    class Iterator {
+      friend class ConcurrentCache;
+      template <bool> friend class Iterator;
+
+      // TYPES:
+      private:
+        typedef typename std::conditional<is_const,
+          typename S1::const_iterator, typename S1::iterator>::type itr_type;
+        typedef typename std::conditional<is_const,
+          const ConcurrentCache*, ConcurrentCache*>::type cache_type;
+      public:
+        typedef typename ConcurrentCache::value_type value_type;
+        typedef typename std::iterator_traits<itr_type>::reference reference;
+        typedef typename std::iterator_traits<itr_type>::pointer pointer;
+        typedef typename ConcurrentCache::difference_type difference_type;
+        typedef typename std::forward_iterator_tag iterator_category;
+
+      // CONSTRUCT/COPY/DESTROY:
+      private:
+        Iterator(cache_type cc, size_t idx) : cc_(cc), idx_(idx) {
+          if (idx_ < cc_->n_) {
+            itr_ = cc_->shards_[idx_].s1.begin();
+            skip();
+          }
+        }
+      public:
+        Iterator() : cc_(nullptr), idx_(0) { }
+        Iterator(const Iterator& rhs) = default;
+        template <bool c = is_const, typename = typename std::enable_if<c>::type>
+        Iterator(const Iterator<false>& rhs) : cc_(rhs.cc_), idx_(rhs.idx_), itr_(rhs.itr_) { }
+        Iterator& operator=(const Iterator& rhs) = default;
+
+        // ABILITIES:
+        reference operator*() const {
+          return *itr_;
+        }
+        pointer operator->() const {
+          return itr_.operator->();
+        }
+        Iterator& operator++() {
+          ++itr_;
+          skip();
+          return *this;
+        }
+        Iterator operator++(int) {
+          auto ret = *this;
+          ++(*this);
+          return ret;
+        }
+        bool operator==(const Iterator& rhs) const {
+          return idx_ == rhs.idx_ && (cc_ == nullptr || idx_ == cc_->n_ || itr_ == rhs.itr_);
+        }
+        bool operator!=(const Iterator& rhs) const {
+          return !(*this == rhs);
+        }
+
+      private:
+        cache_type cc_;
+        size_t idx_;
+        itr_type itr_;
+
+        void skip() {
+          while (itr_ == cc_->shards_[idx_].s1.end()) {
+            if (++idx_ == cc_->n_) {
+              itr_ = itr_type();
+              return;
+            }
+            itr_ = cc_->shards_[idx_].s1.begin();
+          }
+        }
+    };
+
+    // TYPES:
+    // Container:
+    typedef typename S1::value_type value_type;
+    typedef typename S1::reference reference;
+    typedef typename S1::const_reference const_reference;
+    typedef Iterator<false> iterator;
+    typedef Iterator<true> const_iterator;
+    typedef typename S1::difference_type difference_type;
+    typedef typename S1::size_type size_type;
+    // Other:
+    typedef typename S1::k_type k_type;
+    typedef typename S1::v_type v_type;
+
+    // CONSTRUCT/COPY/DESTROY:
+    // Container:
+    ConcurrentCache(S2* s2 = nullptr, size_t c = 16, size_t n = 16) : s2_(s2), capacity_(c), n_(1), shards_(nullptr) {
+      while (n_ < n) {
+        n_ *= 2;
+      }
+      shards_.reset(new Shard[n_]);
+      split();
+    }
+    ConcurrentCache(const ConcurrentCache& rhs) : ConcurrentCache(rhs.s2_, rhs.capacity_, rhs.n_) {
+      for (size_t i = 0; i < n_; ++i) {
+        auto& sh = rhs.shards_[i];
+        std::lock_guard<std::mutex> wlock(sh.wm);
+        std::lock_guard<std::mutex> lock(sh.m);
+        shards_[i].s1 = sh.s1;
+        shards_[i].e = sh.e;
+        shards_[i].r = sh.r;
+        shards_[i].w = sh.w;
+      }
+    }
+    ConcurrentCache(ConcurrentCache&& rhs) : s2_(nullptr), capacity_(0), n_(0), shards_(nullptr) {
+      swap(rhs);
+    }
+    ConcurrentCache& operator=(ConcurrentCache rhs) {
+      swap(rhs);
+      return *this;
+    }
+    ~ConcurrentCache() = default;
+
+    // ITERATORS:
+    // Container:
+    iterator begin() {
+      return iterator(this, 0);
+    }
+    const_iterator begin() const {
+      return const_iterator(this, 0);
+    }
+    iterator end() {
+      return iterator(this, n_);
+    }
+    const_iterator end() const {
+      return const_iterator(this, n_);
+    }
+    const_iterator cbegin() const {
+      return begin();
+    }
+    const_iterator cend() const {
+      return end();
+    }
+
+    // CAPACITY:
+    // Container:
+    bool empty() const {
+      return size() == 0;
+    }
+    size_type size() const {
+      size_type res = 0;
+      for (size_t i = 0; i < n_; ++i) {
+        std::lock_guard<std::mutex> lock(shards_[i].m);
+        res += shards_[i].s1.size();
+      }
+      return res;
+    }
+    size_type max_size() const {
+      return capacity_;
+    }
+
+    // MODIFIERS:
+    // Container:
+    void swap(ConcurrentCache& rhs) {
+      using std::swap;
+      swap(s2_, rhs.s2_);
+      swap(capacity_, rhs.capacity_);
+      swap(n_, rhs.n_);
+      swap(shards_, rhs.shards_);
+    }
+
+    // STORE INTERFACE:
+    // Common:
+    bool contains(const k_type& k) {
+      auto& sh = shard(k);
+      std::lock_guard<std::mutex> lock(sh.m);
+      return sh.s1.contains(k);
+    }
+    v_type get(const k_type& k) {
+      if (s2_ == nullptr) {
+        return v_type();
+      }
+      auto& sh = shard(k);
+      std::promise<val_type> p;
+      {
+        std::unique_lock<std::mutex> lock(sh.m);
+        if (sh.s1.contains(k)) {
+          sh.e.touch(k);
+          return sh.s1.get(k);
+        }
+        auto itr = sh.flights.find(k);
+        if (itr != sh.flights.end()) {
+          auto f = itr->second;
+          ++sh.coalesced;
+          lock.unlock();
+          return f.get();
+        }
+        sh.flights.emplace(k, p.get_future().share());
+      }
+
+      // The flight is only landed once its results are in s1, so that later
+      // gets find them there. A put may have beaten the flight to wm, in
+      // which case s1 holds a newer value than s2 may, and it is served, as
+      // is a value the write policy still holds.
+      val_type res = val_type();
+      try {
+        std::lock_guard<std::mutex> wlock(sh.wm);
+        if (!hit(sh, k, res) && !refill(sh, k, res)) {
+          sh.r.fetch(*s2_, k);
+          fill(sh);
+          for (auto v = sh.r.begin(), ve = sh.r.end(); v != ve; ++v) {
+            if (v->first == k) {
+              res = v->second;
+              break;
+            }
+          }
+        }
+      } catch (...) {
+        land(sh, k);
+        p.set_exception(std::current_exception());
+        throw;
+      }
+      land(sh, k);
+      p.set_value(res);
+      return res;
+    }
+    void put(const value_type& v) {
+      if (s2_ == nullptr) {
+        return;
+      }
+      auto& sh = shard(v.first);
+      std::lock_guard<std::mutex> wlock(sh.wm);
+      invalidate(sh.r, v.first);
+      sh.w.modify(*s2_, v);
+      std::vector<key_type> victims;
+      {
+        std::lock_guard<std::mutex> lock(sh.m);
+        sh.s1.put(v);
+        sh.e.touch(v.first);
+        resize(sh, sh.capacity, victims);
+      }
+      sh.w.flush(*s2_, victims.begin(), victims.end());
+    }
+    void erase(const k_type& k) {
+      if (s2_ == nullptr) {
+        return;
+      }
+      auto& sh = shard(k);
+      std::lock_guard<std::mutex> wlock(sh.wm);
+      sh.w.flush(*s2_, k);
+      std::lock_guard<std::mutex> lock(sh.m);
+      if (sh.s1.contains(k)) {
+        sh.e.erase(k);
+        sh.s1.erase(k);
+      }
+    }
+    void clear() {
+      for (size_t i = 0; i < n_; ++i) {
+        evict(shards_[i], 0);
+      }
+    }
+    // Batched:
+    template <typename KItr, typename OItr>
+    void multi_get(KItr begin, KItr end, OItr out) {
+      const std::vector<key_type> ks(begin, end);
+      std::vector<typename std::remove_const<v_type>::type> vs(ks.size());
+      if (s2_ == nullptr || ks.empty()) {
+        for (const auto& v : vs) {
+          *out++ = v;
+        }
+        return;
+      }
+
+      // Serve hits shard by shard, and collect misses for one batched fetch
+      // per shard. missed holds each such shard and its first miss.
+      const auto idx = partition(ks.begin(), ks.end(), [](const key_type& k) { return k; });
+      std::vector<key_type> misses;
+      std::vector<size_t> midx;
+      std::vector<std::pair<size_t, size_t>> missed;
+      for (size_t i = 0; i < n_; ++i) {
+        if (idx[i].empty()) {
+          continue;
+        }
+        auto& sh = shards_[i];
+        const auto before = misses.size();
+        std::lock_guard<std::mutex> lock(sh.m);
+        for (auto j : idx[i]) {
+          if (sh.s1.contains(ks[j])) {
+            sh.e.touch(ks[j]);
+            vs[j] = sh.s1.get(ks[j]);
+          } else {
+            midx.push_back(j);
+            misses.push_back(ks[j]);
+          }
+        }
+        if (misses.size() > before) {
+          missed.emplace_back(i, before);
+        }
+      }
+
+      // Each shard's misses go through its own read policy, so that policies
+      // which keep state between fetches see every fetch for their keys. As
+      // for get(), a put may have landed some of them since, or the write
+      // policy may hold them, and only those still missing are fetched.
+      std::vector<key_type> rest;
+      std::vector<size_t> ridx;
+      for (size_t m = 0, me = missed.size(); m < me; ++m) {
+        auto& sh = shards_[missed[m].first];
+        const auto mb = missed[m].second;
+        const auto mend = m + 1 < me ? missed[m + 1].second : misses.size();
+        std::lock_guard<std::mutex> wlock(sh.wm);
+        rest.clear();
+        ridx.clear();
+        for (size_t i = mb; i < mend; ++i) {
+          if (!hit(sh, misses[i], vs[midx[i]]) && !refill(sh, misses[i], vs[midx[i]])) {
+            rest.push_back(misses[i]);
+            ridx.push_back(midx[i]);
+          }
+        }
+        if (rest.empty()) {
+          continue;
+        }
+        sh.r.fetch(*s2_, rest.begin(), rest.end());
+        fill(sh);
+        match(sh.r.begin(), sh.r.end(), rest.begin(), rest.end(), [&](size_t i, const v_type& v) {
+          vs[ridx[i]] = v;
+        });
+      }
+
+      for (const auto& v : vs) {
+        *out++ = v;
+      }
+    }
+    template <typename VItr>
+    void multi_put(VItr begin, VItr end) {
+      if (s2_ == nullptr) {
+        return;
+      }
+      const std::vector<value_type> vs(begin, end);
+      const auto idx = partition(vs.begin(), vs.end(), [](const value_type& v) { return v.first; });
+      std::vector<value_type> batch;
+      std::vector<key_type> victims;
+      for (size_t i = 0; i < n_; ++i) {
+        if (idx[i].empty()) {
+          continue;
+        }
+        auto& sh = shards_[i];
+        batch.clear();
+        for (auto j : idx[i]) {
+          batch.push_back(vs[j]);
+        }
+        std::lock_guard<std::mutex> wlock(sh.wm);
+        for (const auto& v : batch) {
+          invalidate(sh.r, v.first);
+        }
+        sh.w.modify(*s2_, batch.begin(), batch.end());
+        victims.clear();
+        {
+          std::lock_guard<std::mutex> lock(sh.m);
+          for (const auto& v : batch) {
+            sh.s1.put(v);
+            sh.e.touch(v.first);
+          }
+          resize(sh, sh.capacity, victims);
+        }
+        sh.w.flush(*s2_, victims.begin(), victims.end());
+      }
+    }
+    template <typename KItr>
+    void multi_erase(KItr begin, KItr end) {
+      if (s2_ == nullptr) {
+        return;
+      }
+      const std::vector<key_type> ks(begin, end);
+      const auto idx = partition(ks.begin(), ks.end(), [](const key_type& k) { return k; });
+      std::vector<key_type> batch;
+      for (size_t i = 0; i < n_; ++i) {
+        if (idx[i].empty()) {
+          continue;
+        }
+        auto& sh = shards_[i];
+        batch.clear();
+        for (auto j : idx[i]) {
+          batch.push_back(ks[j]);
+        }
+        std::lock_guard<std::mutex> wlock(sh.wm);
+        sh.w.flush(*s2_, batch.begin(), batch.end());
+        std::lock_guard<std::mutex> lock(sh.m);
+        for (const auto& k : batch) {
+          if (sh.s1.contains(k)) {
+            sh.e.erase(k);
+            sh.s1.erase(k);
+          }
+        }
+      }
+    }
+    // ConcurrentCache:
+    // Capacity is divided evenly between the shards
+    void capacity(size_t c) {
+      capacity_ = c;
+      split();
+      for (size_t i = 0; i < n_; ++i) {
+        evict(shards_[i], shards_[i].capacity);
+      }
+    }
+    // Not safe to call while other threads use the cache
+    S2* backing_store(S2* s2 = nullptr) {
+      auto ret = s2_;
+      if (s2 != nullptr) {
+        clear();
+        s2_ = s2;
+      }
+      return ret;
+    }
+    size_t shards() const {
+      return n_;
+    }
+    // The number of gets which were served by another get's fetch
+    size_t coalesced() const {
+      size_t res = 0;
+      for (size_t i = 0; i < n_; ++i) {
+        std::lock_guard<std::mutex> lock(shards_[i].m);
+        res += shards_[i].coalesced;
+      }
+      return res;
+    }
+
+    // COMPARISON:
+    // Container:
+    friend bool operator==(const ConcurrentCache& lhs, const ConcurrentCache& rhs) {
+      if (lhs.n_ != rhs.n_) {
+        return false;
+      }
+      for (size_t i = 0; i < lhs.n_; ++i) {
+        if (lhs.shards_[i].s1 != rhs.shards_[i].s1) {
+          return false;
+        }
+      }
+      return true;
+    }
+    friend bool operator!=(const ConcurrentCache& lhs, const ConcurrentCache& rhs) {
+      return !(lhs == rhs);
+    }
+
+    // SPECIALIZED ALGORITHMS:
+    // Container:
+    friend void swap(ConcurrentCache& lhs, ConcurrentCache& rhs) {
+      lhs.swap(rhs);
+    }
+
+  private:
+    S2* s2_;
+    size_t capacity_;
+    size_t n_;
+    std::unique_ptr<Shard[]> shards_;
+
+    size_t index(const key_type& k) const {
+      // Fibonacci hashing on the top bits, as for ShardedStore
+      const uint64_t h = H()(k) * 0x9e3779b97f4a7c15ull;
+      return n_ == 1 ? 0 : h >> (64 - __builtin_ctzll(n_));
+    }
+    Shard& shard(const key_type& k) {
+      return shards_[index(k)];
+    }
+    // The positions in [begin, end) of the keys that belong to each shard
+    template <typename Itr, typename F>
+    std::vector<std::vector<size_t>> partition(Itr begin, Itr end, F key) const {
+      std::vector<std::vector<size_t>> res(n_);
+      for (size_t j = 0; begin != end; ++begin, ++j) {
+        res[index(key(*begin))].push_back(j);
+      }
+      return res;
+    }
+    void split() {
+      for (size_t i = 0; i < n_; ++i) {
+        shards_[i].capacity = capacity_ / n_ + (i < capacity_ % n_ ? 1 : 0);
+      }
+    }
+    // Reads k from sh.s1 into v if it is there
+    bool hit(Shard& sh, const key_type& k, val_type& v) {
+      std::lock_guard<std::mutex> lock(sh.m);
+      if (!sh.s1.contains(k)) {
+        return false;
+      }
+      sh.e.touch(k);
+      v = sh.s1.get(k);
+      return true;
+    }
+
+    // Reads the value sh.w still holds for k into v if there is one, and
+    // puts it back into sh.s1. Expects sh.wm to be held.
+    bool refill(Shard& sh, const key_type& k, val_type& v) {
+      if (!binder::queued(sh.w, k, v)) {
+        return false;
+      }
+      std::vector<key_type> victims;
+      {
+        std::lock_guard<std::mutex> lock(sh.m);
+        sh.s1.put(value_type(k, v));
+        sh.e.touch(k);
+        resize(sh, sh.capacity, victims);
+      }
+      sh.w.flush(*s2_, victims.begin(), victims.end());
+      return true;
+    }
+    void land(Shard& sh, const key_type& k) {
+      std::lock_guard<std::mutex> lock(sh.m);
+      sh.flights.erase(k);
+    }
+
+    // Evicts from sh until it holds at most c keys, collecting the keys which
+    // must then be flushed. Expects sh.m to be held.
+    void resize(Shard& sh, size_t c, std::vector<key_type>& victims) {
+      while (sh.s1.size() > c) {
+        const key_type k = sh.e.evict();
+        sh.e.erase(k);
+        sh.s1.erase(k);
+        victims.push_back(k);
+      }
+    }
+    void evict(Shard& sh, size_t c) {
+      std::lock_guard<std::mutex> wlock(sh.wm);
+      std::vector<key_type> victims;
+      {
+        std::lock_guard<std::mutex> lock(sh.m);
+        resize(sh, c, victims);
+      }
+      if (s2_ != nullptr) {
+        sh.w.flush(*s2_, victims.begin(), victims.end());
+      }
+    }
+    // Moves the results of the shard's last fetch into it. These values are
+    // already in s2, so they bypass the write policy. Expects sh.wm to be
+    // held.
+    void fill(Shard& sh) {
+      std::vector<key_type> victims;
+      {
+        std::lock_guard<std::mutex> lock(sh.m);
+        for (auto v = sh.r.begin(), ve = sh.r.end(); v != ve; ++v) {
+          sh.s1.put(*v);
+          sh.e.touch(v->first);
+          resize(sh, sh.capacity, victims);
+        }
+      }
+      sh.w.flush(*s2_, victims.begin(), victims.end());
+    }
+};
+
+} // namespace binder
+
+#endif
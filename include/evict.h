@@ -1,11 +1,66 @@
 #ifndef BINDER_INCLUDE_EVICT_H
 #define BINDER_INCLUDE_EVICT_H
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
 #include <list>
 #include <map>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "include/flat.h"
 
 namespace binder {
 
+// Policies which make use of the weight of an entry may provide touch(k, w),
+// which Cache invokes instead of touch(k) whenever it puts an entry
+template <typename E, typename K>
+auto touch(E& e, const K& k, size_t w, int) -> decltype(e.touch(k, w), void()) {
+  e.touch(k, w);
+}
+template <typename E, typename K>
+void touch(E& e, const K& k, size_t, long) {
+  e.touch(k);
+}
+template <typename E, typename K>
+void touch(E& e, const K& k, size_t w) {
+  touch(e, k, w, 0);
+}
+
+// Policies whose evict() changes their state, by moving a hand, clearing
+// reference bits or aging priorities, may provide peek(), which returns the
+// key evict() would without changing anything. Cache peeks at the victim
+// before consulting its admission policy, and only evicts it once admitted,
+// so that a rejected candidate leaves the evict policy as it was. Otherwise
+// evict() is invoked in place of peek() and not again.
+template <typename E>
+auto peek(E& e, int) -> decltype(e.peek()) {
+  return e.peek();
+}
+template <typename E>
+auto peek(E& e, long) -> decltype(e.evict()) {
+  return e.evict();
+}
+template <typename E>
+auto peek(E& e) -> decltype(e.evict()) {
+  return peek(e, 0);
+}
+template <typename E, typename K>
+auto evict(E& e, const K&, int) -> decltype(e.peek(), e.evict()) {
+  return e.evict();
+}
+template <typename E, typename K>
+const K& evict(E&, const K& v, long) {
+  return v;
+}
+template <typename E, typename K>
+auto evict(E& e, const K& v) -> decltype(evict(e, v, 0)) {
+  return evict(e, v, 0);
+}
+
 template <typename S>
 class Lru {
   public:
@@ -39,6 +94,641 @@ class Lru {
     std::map<typename S::k_type, typename std::list<typename S::k_type>::iterator> index_;
 };
 
+// An Lru with O(1) expected operations which never allocate on a hit. Keys are
+// held in intrusive doubly linked nodes drawn from a pool, and indexed by a
+// FlatStore of node numbers. Node 0 is the head of the (circular) list, and
+// unused nodes are chained through next into a free list.
+template <typename S, typename H = std::hash<typename std::remove_const<typename S::k_type>::type>>
+class HashLru {
+  private:
+    typedef typename std::remove_const<typename S::k_type>::type key_type;
+
+  public:
+    HashLru() : nodes_(1), free_(0) {
+      nodes_[0].prev = nodes_[0].next = 0;
+    }
+
+    void erase(const typename S::k_type& k) {
+      const auto n = index_.get(k);
+      if (n != 0) {
+        index_.erase(k);
+        unlink(n);
+        nodes_[n].next = free_;
+        free_ = n;
+      }
+    }
+    void touch(const typename S::k_type& k) {
+      auto n = index_.get(k);
+      if (n != 0) {
+        unlink(n);
+      } else {
+        n = acquire(k);
+        index_.put(std::make_pair(k, n));
+      }
+      link(n);
+    }
+    typename S::k_type evict() {
+      return nodes_[nodes_[0].prev].key;
+    }
+    void reserve(size_t n) {
+      nodes_.reserve(n+1);
+      index_.reserve(n);
+    }
+    friend void swap(HashLru& lhs, HashLru& rhs) {
+      using std::swap;
+      swap(lhs.nodes_, rhs.nodes_);
+      swap(lhs.free_, rhs.free_);
+      swap(lhs.index_, rhs.index_);
+    }
+
+  private:
+    struct Node {
+      key_type key;
+      uint32_t prev;
+      uint32_t next;
+    };
+
+    std::vector<Node> nodes_;
+    uint32_t free_;
+    FlatStore<key_type, uint32_t, H> index_;
+
+    uint32_t acquire(const key_type& k) {
+      if (free_ != 0) {
+        const auto n = free_;
+        free_ = nodes_[n].next;
+        nodes_[n].key = k;
+        return n;
+      }
+      nodes_.push_back(Node{k, 0, 0});
+      return (uint32_t)(nodes_.size()-1);
+    }
+    // Moves n to the front of the list
+    void link(uint32_t n) {
+      nodes_[n].prev = 0;
+      nodes_[n].next = nodes_[0].next;
+      nodes_[nodes_[0].next].prev = n;
+      nodes_[0].next = n;
+    }
+    void unlink(uint32_t n) {
+      nodes_[nodes_[n].prev].next = nodes_[n].next;
+      nodes_[nodes_[n].next].prev = nodes_[n].prev;
+    }
+};
+
+// Keys partitioned between N lists which share one index. Each list is ordered
+// from its most (front) to least (back) recently inserted key, and keys move
+// between lists without allocating.
+template <typename K, size_t N, typename H = std::hash<K>>
+class KeyLists {
+  public:
+    KeyLists() = default;
+    KeyLists(const KeyLists& rhs) {
+      for (size_t l = 0; l < N; ++l) {
+        for (auto k = rhs.lists_[l].rbegin(); k != rhs.lists_[l].rend(); ++k) {
+          push(l, *k);
+        }
+      }
+    }
+    KeyLists(KeyLists&& rhs) = default;
+    KeyLists& operator=(KeyLists rhs) {
+      swap(*this, rhs);
+      return *this;
+    }
+
+    // The list holding k, or N if there is none
+    size_t find(const K& k) const {
+      auto itr = index_.find(k);
+      return itr != index_.end() ? itr->second.first : N;
+    }
+    size_t size(size_t l) const {
+      return lists_[l].size();
+    }
+    const K& back(size_t l) const {
+      return lists_[l].back();
+    }
+    // Inserts k at the front of list l, moving it there if already present
+    void push(size_t l, const K& k) {
+      auto itr = index_.find(k);
+      if (itr != index_.end()) {
+        auto& e = itr->second;
+        lists_[l].splice(lists_[l].begin(), lists_[e.first], e.second);
+        e.first = l;
+      } else {
+        lists_[l].push_front(k);
+        index_.insert(std::make_pair(k, std::make_pair(l, lists_[l].begin())));
+      }
+    }
+    void erase(const K& k) {
+      auto itr = index_.find(k);
+      if (itr != index_.end()) {
+        lists_[itr->second.first].erase(itr->second.second);
+        index_.erase(itr);
+      }
+    }
+    friend void swap(KeyLists& lhs, KeyLists& rhs) {
+      using std::swap;
+      for (size_t i = 0; i < N; ++i) {
+        swap(lhs.lists_[i], rhs.lists_[i]);
+      }
+      swap(lhs.index_, rhs.index_);
+    }
+
+  private:
+    std::list<K> lists_[N];
+    std::unordered_map<K, std::pair<size_t, typename std::list<K>::iterator>, H> index_;
+};
+
+// Adaptive Replacement Cache (Megiddo and Modha). Resident keys are split
+// between t1, which holds keys seen once recently, and t2, which holds keys
+// seen at least twice. Evicted keys are remembered in the ghost lists b1 and
+// b2, and a hit on a ghost shifts the target size p of t1 towards the list
+// that would have kept it. A scan only passes through t1, so it cannot flush
+// t2.
+//
+// Policies aren't told the capacity, so c is taken to be the number of
+// resident keys less the one being admitted at each eviction. Ghosts are
+// bounded so that |t1|+|b1| <= c and |t1|+|t2|+|b1|+|b2| <= 2c. Keys evicted
+// by evict() become ghosts when erased, whereas other erased keys are
+// forgotten.
+template <typename S, typename H = std::hash<typename std::remove_const<typename S::k_type>::type>>
+class Arc {
+  private:
+    typedef typename std::remove_const<typename S::k_type>::type key_type;
+
+  public:
+    Arc() : c_(0), p_(0), fresh_(false), ghost_(false), victim_(false) { }
+
+    void erase(const typename S::k_type& k) {
+      const auto l = ls_.find(k);
+      if (victim_ && (l == T1 || l == T2) && k == ls_.back(l)) {
+        ls_.push(l == T1 ? B1 : B2, k);
+        trim();
+      } else {
+        ls_.erase(k);
+      }
+      victim_ = fresh_ = ghost_ = false;
+    }
+    void touch(const typename S::k_type& k) {
+      const auto l = ls_.find(k);
+      fresh_ = l == NONE;
+      ghost_ = l == B2;
+      if (l == B1) {
+        const auto d = std::max<size_t>(ls_.size(B2) / ls_.size(B1), 1);
+        p_ = std::min(p_ + d, c_);
+      } else if (l == B2) {
+        const auto d = std::max<size_t>(ls_.size(B1) / ls_.size(B2), 1);
+        p_ = p_ > d ? p_ - d : 0;
+      }
+      ls_.push(fresh_ ? T1 : T2, k);
+      trim();
+    }
+    typename S::k_type peek() const {
+      const auto t1 = ls_.size(T1) - (fresh_ ? 1 : 0);
+      if (ls_.size(T2) == 0 || (t1 > 0 && (t1 > p_ || (ghost_ && t1 == p_)))) {
+        return ls_.back(T1);
+      }
+      return ls_.back(T2);
+    }
+    typename S::k_type evict() {
+      const auto n = ls_.size(T1) + ls_.size(T2);
+      c_ = n > 0 ? n-1 : 0;
+      victim_ = true;
+      return peek();
+    }
+    size_t ghosts() const {
+      return ls_.size(B1) + ls_.size(B2);
+    }
+    friend void swap(Arc& lhs, Arc& rhs) {
+      using std::swap;
+      swap(lhs.ls_, rhs.ls_);
+      swap(lhs.c_, rhs.c_);
+      swap(lhs.p_, rhs.p_);
+      swap(lhs.fresh_, rhs.fresh_);
+      swap(lhs.ghost_, rhs.ghost_);
+      swap(lhs.victim_, rhs.victim_);
+    }
+
+  private:
+    enum { T1, T2, B1, B2, NONE };
+
+    KeyLists<key_type, NONE, H> ls_;
+    size_t c_;
+    size_t p_;
+    // Whether the last touch admitted a new key, or revived a b2 ghost
+    bool fresh_;
+    bool ghost_;
+    // Whether the next erase follows an evict
+    bool victim_;
+
+    void trim() {
+      while (ls_.size(B1) > 0 && ls_.size(T1) + ls_.size(B1) > c_) {
+        ls_.erase(ls_.back(B1));
+      }
+      auto n = ls_.size(T1) + ls_.size(T2) + ls_.size(B1) + ls_.size(B2);
+      for (; n > 2*c_ && ls_.size(B2) + ls_.size(B1) > 0; --n) {
+        ls_.erase(ls_.back(ls_.size(B2) > 0 ? B2 : B1));
+      }
+    }
+};
+
+// The full 2Q policy (Johnson and Shasha). New keys enter a1in, a FIFO of
+// about a quarter of the cache, and keys evicted from it are remembered in
+// the ghost FIFO a1out, of about half the cache. Only a key referenced again
+// while it is a ghost is admitted to am, an Lru of the remainder, so a scan
+// only ever churns a1in. Capacity is inferred as it is for Arc.
+template <typename S, typename H = std::hash<typename std::remove_const<typename S::k_type>::type>>
+class TwoQ {
+  private:
+    typedef typename std::remove_const<typename S::k_type>::type key_type;
+
+  public:
+    TwoQ() : c_(0), fresh_(false), victim_(false) { }
+
+    void erase(const typename S::k_type& k) {
+      if (victim_ && ls_.find(k) == A1IN && k == ls_.back(A1IN)) {
+        ls_.push(A1OUT, k);
+        while (ls_.size(A1OUT) > std::max<size_t>(c_/2, 1)) {
+          ls_.erase(ls_.back(A1OUT));
+        }
+      } else {
+        ls_.erase(k);
+      }
+      victim_ = fresh_ = false;
+    }
+    void touch(const typename S::k_type& k) {
+      const auto l = ls_.find(k);
+      fresh_ = l == NONE;
+      if (fresh_) {
+        ls_.push(A1IN, k);
+      } else if (l != A1IN) {
+        ls_.push(AM, k);
+      }
+    }
+    typename S::k_type peek() const {
+      const auto n = ls_.size(A1IN) + ls_.size(AM);
+      const auto c = n > 0 ? n-1 : 0;
+      const auto a1in = ls_.size(A1IN) - (fresh_ ? 1 : 0);
+      if (ls_.size(AM) == 0 || a1in > std::max<size_t>(c/4, 1)) {
+        return ls_.back(A1IN);
+      }
+      return ls_.back(AM);
+    }
+    typename S::k_type evict() {
+      const auto n = ls_.size(A1IN) + ls_.size(AM);
+      c_ = n > 0 ? n-1 : 0;
+      victim_ = true;
+      return peek();
+    }
+    size_t ghosts() const {
+      return ls_.size(A1OUT);
+    }
+    friend void swap(TwoQ& lhs, TwoQ& rhs) {
+      using std::swap;
+      swap(lhs.ls_, rhs.ls_);
+      swap(lhs.c_, rhs.c_);
+      swap(lhs.fresh_, rhs.fresh_);
+      swap(lhs.victim_, rhs.victim_);
+    }
+
+  private:
+    enum { A1IN, AM, A1OUT, NONE };
+
+    KeyLists<key_type, NONE, H> ls_;
+    size_t c_;
+    // Whether the last touch admitted a new key
+    bool fresh_;
+    // Whether the next erase follows an evict
+    bool victim_;
+};
+
+// A reference bit which concurrent hits may set while holding no more than a
+// shared lock. It is only written if it isn't already set, so that hits on a
+// hot key don't contend for its cache line.
+class RefBit {
+  public:
+    RefBit() : b_(0) { }
+    RefBit(const RefBit& rhs) : b_(rhs.get()) { }
+    RefBit& operator=(const RefBit& rhs) {
+      b_.store(rhs.get(), std::memory_order_relaxed);
+      return *this;
+    }
+
+    bool get() const {
+      return b_.load(std::memory_order_relaxed) != 0;
+    }
+    void set() {
+      if (!get()) {
+        b_.store(1, std::memory_order_relaxed);
+      }
+    }
+    void clear() {
+      b_.store(0, std::memory_order_relaxed);
+    }
+
+  private:
+    std::atomic<uint8_t> b_;
+};
+
+// CLOCK approximates Lru with a reference bit per key. Keys sit in a ring of
+// slots, and a hit only sets the key's bit, so touching a resident key neither
+// allocates nor reorders anything. evict() sweeps the hand around the ring,
+// clearing set bits, and stops at the first key whose bit is clear. The key
+// admitted by the last touch is passed over, since Cache touches a new key
+// before making room for it.
+template <typename S, typename H = std::hash<typename std::remove_const<typename S::k_type>::type>>
+class Clock {
+  private:
+    typedef typename std::remove_const<typename S::k_type>::type key_type;
+
+  public:
+    Clock() : hand_(0), fresh_(0) { }
+
+    void erase(const typename S::k_type& k) {
+      const auto n = index_.get(k);
+      if (n != 0) {
+        index_.erase(k);
+        slots_[n-1].used = false;
+        free_.push_back(n-1);
+      }
+    }
+    void touch(const typename S::k_type& k) {
+      const auto n = index_.get(k);
+      if (n != 0) {
+        slots_[n-1].ref.set();
+        return;
+      }
+      if (!free_.empty()) {
+        fresh_ = free_.back();
+        free_.pop_back();
+        slots_[fresh_].key = k;
+        slots_[fresh_].ref.clear();
+        slots_[fresh_].used = true;
+      } else {
+        fresh_ = (uint32_t)slots_.size();
+        slots_.push_back(Slot{k, RefBit(), true});
+      }
+      index_.put(std::make_pair(k, fresh_+1));
+    }
+    typename S::k_type evict() {
+      const auto n = slots_.size();
+      for (;; hand_ = (hand_+1) % n) {
+        auto& s = slots_[hand_];
+        if (!s.used || (hand_ == fresh_ && index_.size() > 1)) {
+          continue;
+        }
+        if (s.ref.get()) {
+          s.ref.clear();
+          continue;
+        }
+        const auto v = hand_;
+        hand_ = (hand_+1) % n;
+        return slots_[v].key;
+      }
+    }
+    // The first clear key from the hand, or if every bit is set, the first
+    // key from the hand, which evict() reaches once it has cleared them all
+    typename S::k_type peek() const {
+      const auto n = slots_.size();
+      size_t first = n;
+      for (size_t i = 0, h = hand_; i < n; ++i, h = (h+1) % n) {
+        const auto& s = slots_[h];
+        if (!s.used || (h == fresh_ && index_.size() > 1)) {
+          continue;
+        }
+        if (!s.ref.get()) {
+          return s.key;
+        }
+        first = first == n ? h : first;
+      }
+      return slots_[first].key;
+    }
+    void reserve(size_t n) {
+      slots_.reserve(n);
+      index_.reserve(n);
+    }
+    friend void swap(Clock& lhs, Clock& rhs) {
+      using std::swap;
+      swap(lhs.slots_, rhs.slots_);
+      swap(lhs.free_, rhs.free_);
+      swap(lhs.hand_, rhs.hand_);
+      swap(lhs.fresh_, rhs.fresh_);
+      swap(lhs.index_, rhs.index_);
+    }
+
+  private:
+    struct Slot {
+      key_type key;
+      RefBit ref;
+      bool used;
+    };
+
+    std::vector<Slot> slots_;
+    std::vector<uint32_t> free_;
+    uint32_t hand_;
+    uint32_t fresh_;
+    // Slot numbers plus one, so that 0 means absent
+    FlatStore<key_type, uint32_t, H> index_;
+};
+
+// SIEVE (Zhang et al.) keeps keys in insertion order with a visited bit, which
+// a hit sets, as for Clock. The hand moves from the oldest key towards the
+// newest, clearing visited bits, and evicts the first unvisited key it finds,
+// but keys are never moved. Survivors stay where they are, so new keys which
+// are not revisited are evicted quickly, which makes Sieve resistant to scans.
+// Nodes are pooled as for HashLru, with node 0 at the head of the list.
+template <typename S, typename H = std::hash<typename std::remove_const<typename S::k_type>::type>>
+class Sieve {
+  private:
+    typedef typename std::remove_const<typename S::k_type>::type key_type;
+
+  public:
+    Sieve() : nodes_(1), free_(0), hand_(0), fresh_(0) {
+      nodes_[0].prev = nodes_[0].next = 0;
+    }
+
+    void erase(const typename S::k_type& k) {
+      const auto n = index_.get(k);
+      if (n != 0) {
+        index_.erase(k);
+        if (hand_ == n) {
+          hand_ = nodes_[n].prev;
+        }
+        nodes_[nodes_[n].prev].next = nodes_[n].next;
+        nodes_[nodes_[n].next].prev = nodes_[n].prev;
+        nodes_[n].next = free_;
+        free_ = n;
+      }
+    }
+    void touch(const typename S::k_type& k) {
+      const auto n = index_.get(k);
+      if (n != 0) {
+        nodes_[n].ref.set();
+        return;
+      }
+      if (free_ != 0) {
+        fresh_ = free_;
+        free_ = nodes_[fresh_].next;
+        nodes_[fresh_].key = k;
+        nodes_[fresh_].ref.clear();
+      } else {
+        fresh_ = (uint32_t)nodes_.size();
+        nodes_.push_back(Node{k, RefBit(), 0, 0});
+      }
+      nodes_[fresh_].prev = 0;
+      nodes_[fresh_].next = nodes_[0].next;
+      nodes_[nodes_[0].next].prev = fresh_;
+      nodes_[0].next = fresh_;
+      index_.put(std::make_pair(k, fresh_));
+    }
+    typename S::k_type evict() {
+      auto n = hand_ != 0 ? hand_ : nodes_[0].prev;
+      for (;; n = nodes_[n].prev != 0 ? nodes_[n].prev : nodes_[0].prev) {
+        if (n == fresh_ && index_.size() > 1) {
+          continue;
+        }
+        if (nodes_[n].ref.get()) {
+          nodes_[n].ref.clear();
+          continue;
+        }
+        hand_ = n;
+        return nodes_[n].key;
+      }
+    }
+    // As for Clock, the first unvisited key from the hand, or the first key
+    // from the hand if every key has been visited
+    typename S::k_type peek() const {
+      auto n = hand_ != 0 ? hand_ : nodes_[0].prev;
+      uint32_t first = 0;
+      for (size_t i = 0, ie = index_.size(); i < ie; ++i) {
+        if (n != fresh_ || ie == 1) {
+          if (!nodes_[n].ref.get()) {
+            return nodes_[n].key;
+          }
+          first = first == 0 ? n : first;
+        }
+        n = nodes_[n].prev != 0 ? nodes_[n].prev : nodes_[0].prev;
+      }
+      return nodes_[first].key;
+    }
+    void reserve(size_t n) {
+      nodes_.reserve(n+1);
+      index_.reserve(n);
+    }
+    friend void swap(Sieve& lhs, Sieve& rhs) {
+      using std::swap;
+      swap(lhs.nodes_, rhs.nodes_);
+      swap(lhs.free_, rhs.free_);
+      swap(lhs.hand_, rhs.hand_);
+      swap(lhs.fresh_, rhs.fresh_);
+      swap(lhs.index_, rhs.index_);
+    }
+
+  private:
+    struct Node {
+      key_type key;
+      RefBit ref;
+      uint32_t prev;
+      uint32_t next;
+    };
+
+    std::vector<Node> nodes_;
+    uint32_t free_;
+    uint32_t hand_;
+    uint32_t fresh_;
+    FlatStore<key_type, uint32_t, H> index_;
+};
+
+// GreedyDual-Size-Frequency (Cherkasova). Each key has priority L + f/w, where
+// f counts its touches, w is its weight and L is the priority of the last key
+// evicted, and the key with the lowest priority is evicted first. Small, often
+// touched keys are kept over large ones, and L ages keys which are no longer
+// touched. Keys touched without a weight weigh 1.
+template <typename S>
+class Gdsf {
+  private:
+    typedef typename std::remove_const<typename S::k_type>::type key_type;
+
+  public:
+    Gdsf() : l_(0), fresh_(false), fresh_key_() { }
+    Gdsf(const Gdsf& rhs) : index_(rhs.index_), l_(rhs.l_), fresh_(rhs.fresh_), fresh_key_(rhs.fresh_key_) {
+      for (auto& e : index_) {
+        e.second.pos = queue_.insert(std::make_pair(e.second.pos->first, e.first));
+      }
+    }
+    Gdsf(Gdsf&& rhs) = default;
+    Gdsf& operator=(Gdsf rhs) {
+      swap(*this, rhs);
+      return *this;
+    }
+
+    void erase(const typename S::k_type& k) {
+      auto itr = index_.find(k);
+      if (itr != index_.end()) {
+        queue_.erase(itr->second.pos);
+        index_.erase(itr);
+      }
+      fresh_ = false;
+    }
+    void touch(const typename S::k_type& k) {
+      auto itr = index_.find(k);
+      touch(k, itr != index_.end() ? itr->second.w : 1);
+    }
+    void touch(const typename S::k_type& k, size_t w) {
+      auto itr = index_.find(k);
+      fresh_ = itr == index_.end();
+      if (fresh_) {
+        itr = index_.insert(itr, std::make_pair(k, Entry{0, w, queue_.end()}));
+        fresh_key_ = k;
+      } else {
+        queue_.erase(itr->second.pos);
+      }
+      auto& e = itr->second;
+      ++e.f;
+      e.w = std::max<size_t>(w, 1);
+      e.pos = queue_.insert(std::make_pair(l_ + double(e.f) / e.w, k));
+    }
+    typename S::k_type peek() const {
+      return victim()->second;
+    }
+    typename S::k_type evict() {
+      const auto itr = victim();
+      l_ = itr->first;
+      fresh_ = false;
+      return itr->second;
+    }
+    friend void swap(Gdsf& lhs, Gdsf& rhs) {
+      using std::swap;
+      swap(lhs.queue_, rhs.queue_);
+      swap(lhs.index_, rhs.index_);
+      swap(lhs.l_, rhs.l_);
+      swap(lhs.fresh_, rhs.fresh_);
+      swap(lhs.fresh_key_, rhs.fresh_key_);
+    }
+
+  private:
+    typedef std::multimap<double, key_type> Queue;
+    struct Entry {
+      size_t f;
+      size_t w;
+      typename Queue::iterator pos;
+    };
+
+    typename Queue::const_iterator victim() const {
+      auto itr = queue_.cbegin();
+      if (fresh_ && itr->second == fresh_key_ && queue_.size() > 1) {
+        ++itr;
+      }
+      return itr;
+    }
+
+    Queue queue_;
+    std::map<key_type, Entry> index_;
+    double l_;
+    // Whether the last touch admitted a new key, which evict() passes over
+    bool fresh_;
+    key_type fresh_key_;
+};
+
 } // namespace binder 
 
 #endif
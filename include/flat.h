@@ -0,0 +1,398 @@
+#ifndef BINDER_INCLUDE_FLAT_H
+#define BINDER_INCLUDE_FLAT_H
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace binder {
+
+template <typename K, typename V, typename H = std::hash<K>, typename E = std::equal_to<K>>
+class FlatStore {
+  private:
+    typedef typename std::aligned_storage<
+      sizeof(std::pair<const K, const V>),
+      alignof(std::pair<const K, const V>)>::type slot_type;
+
+    // Control bytes: A full slot holds the low 7 bits of its key's hash, an
+    // open slot holds one of the (negative) markers below.
+    enum : int8_t {
+      EMPTY = -128,
+      DELETED = -2,
+      SENTINEL = -1
+    };
+    // Slots are probed in aligned groups of this many control bytes
+    static constexpr size_t GROUP = 16;
+
+  public:
+    template <bool is_const>
+    class Iterator {
+      friend class FlatStore;
+      template <bool> friend class Iterator;
+
+      // TYPES:
+      public:
+        typedef typename FlatStore::value_type value_type;
+        typedef typename std::conditional<is_const, const value_type&, value_type&>::type reference;
+        typedef typename std::conditional<is_const, const value_type*, value_type*>::type pointer;
+        typedef typename FlatStore::difference_type difference_type;
+        typedef typename std::forward_iterator_tag iterator_category;
+
+      // CONSTRUCT/COPY/DESTROY:
+      private:
+        Iterator(const int8_t* ctrl, slot_type* slot) : ctrl_(ctrl), slot_(slot) {
+          skip();
+        }
+      public:
+        Iterator() : ctrl_(nullptr), slot_(nullptr) { }
+        Iterator(const Iterator& rhs) = default;
+        template <bool c = is_const, typename = typename std::enable_if<c>::type>
+        Iterator(const Iterator<false>& rhs) : ctrl_(rhs.ctrl_), slot_(rhs.slot_) { }
+        Iterator& operator=(const Iterator& rhs) = default;
+
+        // ABILITIES:
+        reference operator*() const {
+          return *reinterpret_cast<value_type*>(slot_);
+        }
+        pointer operator->() const {
+          return reinterpret_cast<value_type*>(slot_);
+        }
+        Iterator& operator++() {
+          ++ctrl_;
+          ++slot_;
+          skip();
+          return *this;
+        }
+        Iterator operator++(int) {
+          auto ret = *this;
+          ++(*this);
+          return ret;
+        }
+        bool operator==(const Iterator& rhs) const {
+          return ctrl_ == rhs.ctrl_;
+        }
+        bool operator!=(const Iterator& rhs) const {
+          return !(*this == rhs);
+        }
+
+      private:
+        const int8_t* ctrl_;
+        slot_type* slot_;
+
+        void skip() {
+          // The sentinel which follows the last slot stops this loop
+          for (; ctrl_ != nullptr && *ctrl_ < SENTINEL; ++ctrl_, ++slot_);
+        }
+    };
+
+    // TYPES:
+    // Container:
+    typedef std::pair<const K, const V> value_type;
+    typedef value_type& reference;
+    typedef const value_type& const_reference;
+    typedef Iterator<false> iterator;
+    typedef Iterator<true> const_iterator;
+    typedef ptrdiff_t difference_type;
+    typedef size_t size_type;
+    // Other:
+    typedef K k_type;
+    typedef const V v_type;
+
+    // CONSTRUCT/COPY/DESTROY:
+    // Container:
+    FlatStore() : ctrl_(nullptr), slots_(nullptr), capacity_(0), size_(0), deleted_(0) { }
+    FlatStore(const FlatStore& rhs) : FlatStore() {
+      if (rhs.capacity_ == 0) {
+        return;
+      }
+      allocate(rhs.capacity_);
+      std::memcpy(ctrl_, rhs.ctrl_, capacity_);
+      for (size_t i = 0; i < capacity_; ++i) {
+        if (ctrl_[i] >= 0) {
+          new (&slots_[i]) value_type(*rhs.slot(i));
+        }
+      }
+      size_ = rhs.size_;
+      deleted_ = rhs.deleted_;
+    }
+    FlatStore(FlatStore&& rhs) : FlatStore() {
+      swap(rhs);
+    }
+    FlatStore& operator=(FlatStore rhs) {
+      swap(rhs);
+      return *this;
+    }
+    ~FlatStore() {
+      destroy();
+      deallocate();
+    }
+
+    // ITERATORS:
+    // Container:
+    iterator begin() {
+      return iterator(ctrl_, slots_);
+    }
+    const_iterator begin() const {
+      return const_iterator(ctrl_, slots_);
+    }
+    iterator end() {
+      return iterator(ctrl_ + capacity_, slots_ + capacity_);
+    }
+    const_iterator end() const {
+      return const_iterator(ctrl_ + capacity_, slots_ + capacity_);
+    }
+    const_iterator cbegin() const {
+      return begin();
+    }
+    const_iterator cend() const {
+      return end();
+    }
+
+    // CAPACITY:
+    // Container:
+    bool empty() const {
+      return size_ == 0;
+    }
+    size_type size() const {
+      return size_;
+    }
+    size_type max_size() const {
+      return std::numeric_limits<size_type>::max() / (sizeof(slot_type) + 1);
+    }
+
+    // MODIFIERS:
+    // Container:
+    void swap(FlatStore& rhs) {
+      using std::swap;
+      swap(ctrl_, rhs.ctrl_);
+      swap(slots_, rhs.slots_);
+      swap(capacity_, rhs.capacity_);
+      swap(size_, rhs.size_);
+      swap(deleted_, rhs.deleted_);
+    }
+
+    // STORE INTERFACE:
+    // Common:
+    bool contains(const k_type& k) {
+      return find(k) != capacity_;
+    }
+    v_type get(const k_type& k) {
+      const auto idx = find(k);
+      return idx == capacity_ ? V() : slot(idx)->second;
+    }
+    void put(const value_type& v) {
+      const auto idx = find(v.first);
+      if (idx != capacity_) {
+        slot(idx)->~value_type();
+        new (&slots_[idx]) value_type(v);
+        return;
+      }
+      if ((size_ + deleted_ + 1) * 8 > capacity_ * 7) {
+        // Reclaim tombstones in place unless we're genuinely out of room
+        rehash(capacity_ == 0 ? GROUP : (size_ + 1) * 16 > capacity_ * 7 ? 2 * capacity_ : capacity_);
+      }
+      insert(hash(v.first), v);
+    }
+    void erase(const k_type& k) {
+      const auto idx = find(k);
+      if (idx == capacity_) {
+        return;
+      }
+      slot(idx)->~value_type();
+      --size_;
+      // A group which already has an empty slot never caused a probe to
+      // continue past it, so this slot can be reopened without a tombstone.
+      if (match_empty(ctrl_ + idx / GROUP * GROUP) != 0) {
+        ctrl_[idx] = EMPTY;
+      } else {
+        ctrl_[idx] = DELETED;
+        ++deleted_;
+      }
+    }
+    void clear() {
+      destroy();
+      if (capacity_ > 0) {
+        std::memset(ctrl_, EMPTY, capacity_);
+      }
+      size_ = 0;
+      deleted_ = 0;
+    }
+    // FlatStore:
+    void reserve(size_t n) {
+      size_t c = GROUP;
+      while (n * 8 > c * 7) {
+        c *= 2;
+      }
+      if (c > capacity_) {
+        rehash(c);
+      }
+    }
+
+    // COMPARISON:
+    // Container:
+    friend bool operator==(const FlatStore& lhs, const FlatStore& rhs) {
+      if (lhs.size_ != rhs.size_) {
+        return false;
+      }
+      for (const auto& v : lhs) {
+        const auto idx = rhs.find(v.first);
+        if (idx == rhs.capacity_ || !(rhs.slot(idx)->second == v.second)) {
+          return false;
+        }
+      }
+      return true;
+    }
+    friend bool operator!=(const FlatStore& lhs, const FlatStore& rhs) {
+      return !(lhs == rhs);
+    }
+
+    // SPECIALIZED ALGORITHMS:
+    // Container:
+    friend void swap(FlatStore& lhs, FlatStore& rhs) {
+      lhs.swap(rhs);
+    }
+
+  private:
+    // capacity_ control bytes followed by a sentinel
+    int8_t* ctrl_;
+    slot_type* slots_;
+    size_t capacity_;
+    size_t size_;
+    size_t deleted_;
+
+    value_type* slot(size_t idx) const {
+      return reinterpret_cast<value_type*>(&slots_[idx]);
+    }
+
+    static size_t hash(const K& k) {
+      // std::hash is the identity for integers; mix so that both the group
+      // index (high bits) and the control byte (low bits) are well spread.
+      uint64_t h = H()(k);
+      h ^= h >> 33;
+      h *= 0xff51afd7ed558ccdull;
+      h ^= h >> 33;
+      return h;
+    }
+
+    // Bitmasks over the slots of the group beginning at g
+    static uint32_t match(const int8_t* g, int8_t h) {
+#ifdef __SSE2__
+      const auto ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(g));
+      return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h), ctrl));
+#else
+      uint32_t res = 0;
+      for (size_t i = 0; i < GROUP; ++i) {
+        res |= (uint32_t)(g[i] == h) << i;
+      }
+      return res;
+#endif
+    }
+    static uint32_t match_empty(const int8_t* g) {
+      return match(g, EMPTY);
+    }
+    static uint32_t match_open(const int8_t* g) {
+#ifdef __SSE2__
+      const auto ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(g));
+      return _mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(SENTINEL), ctrl));
+#else
+      uint32_t res = 0;
+      for (size_t i = 0; i < GROUP; ++i) {
+        res |= (uint32_t)(g[i] < SENTINEL) << i;
+      }
+      return res;
+#endif
+    }
+
+    // Returns the slot index holding k, or capacity_ if there is none. Groups
+    // are visited in triangular order, which covers every group when the
+    // number of groups is a power of two.
+    size_t find(const K& k) const {
+      if (capacity_ == 0) {
+        return capacity_;
+      }
+      const auto h = hash(k);
+      const auto tag = (int8_t)(h & 0x7f);
+      const auto mask = capacity_ / GROUP - 1;
+      for (size_t g = (h >> 7) & mask, i = 1; ; g = (g + i++) & mask) {
+        const auto ctrl = ctrl_ + g * GROUP;
+        for (auto m = match(ctrl, tag); m != 0; m &= m - 1) {
+          const auto idx = g * GROUP + __builtin_ctz(m);
+          if (E()(slot(idx)->first, k)) {
+            return idx;
+          }
+        }
+        if (match_empty(ctrl) != 0) {
+          return capacity_;
+        }
+      }
+    }
+    // Places a key known not to be present in the first open slot on its
+    // probe sequence. The load factor guarantees that one exists.
+    template <typename T>
+    void insert(size_t h, T&& v) {
+      const auto mask = capacity_ / GROUP - 1;
+      for (size_t g = (h >> 7) & mask, i = 1; ; g = (g + i++) & mask) {
+        const auto m = match_open(ctrl_ + g * GROUP);
+        if (m != 0) {
+          const auto idx = g * GROUP + __builtin_ctz(m);
+          deleted_ -= ctrl_[idx] == DELETED;
+          ctrl_[idx] = (int8_t)(h & 0x7f);
+          new (&slots_[idx]) value_type(std::forward<T>(v));
+          ++size_;
+          return;
+        }
+      }
+    }
+
+    void allocate(size_t c) {
+      ctrl_ = new int8_t[c + 1];
+      std::memset(ctrl_, EMPTY, c);
+      ctrl_[c] = SENTINEL;
+      slots_ = new slot_type[c];
+      capacity_ = c;
+    }
+    void deallocate() {
+      delete[] ctrl_;
+      delete[] slots_;
+      ctrl_ = nullptr;
+      slots_ = nullptr;
+      capacity_ = 0;
+    }
+    void destroy() {
+      for (size_t i = 0; i < capacity_; ++i) {
+        if (ctrl_[i] >= 0) {
+          slot(i)->~value_type();
+        }
+      }
+    }
+    void rehash(size_t c) {
+      auto ctrl = ctrl_;
+      auto slots = slots_;
+      const auto capacity = capacity_;
+
+      allocate(c);
+      size_ = 0;
+      deleted_ = 0;
+      for (size_t i = 0; i < capacity; ++i) {
+        if (ctrl[i] >= 0) {
+          auto v = reinterpret_cast<value_type*>(&slots[i]);
+          insert(hash(v->first), std::move(*v));
+          v->~value_type();
+        }
+      }
+      delete[] ctrl;
+      delete[] slots;
+    }
+};
+
+} // namespace binder
+
+#endif
@@ -0,0 +1,623 @@
+#ifndef BINDER_INCLUDE_FUSED_H
+#define BINDER_INCLUDE_FUSED_H
+
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "include/evict.h"
+#include "include/multi.h"
+#include "include/read.h"
+#include "include/write.h"
+
+namespace binder {
+
+// The order in which FusedCache evicts, given the evict policy it is
+// instantiated with
+enum class FusedOrder { LRU, CLOCK, SIEVE };
+template <typename E>
+struct FusedEvict;
+template <typename S>
+struct FusedEvict<Lru<S>> : std::integral_constant<FusedOrder, FusedOrder::LRU> { };
+template <typename S, typename H>
+struct FusedEvict<HashLru<S,H>> : std::integral_constant<FusedOrder, FusedOrder::LRU> { };
+template <typename S, typename H>
+struct FusedEvict<Clock<S,H>> : std::integral_constant<FusedOrder, FusedOrder::CLOCK> { };
+template <typename S, typename H>
+struct FusedEvict<Sieve<S,H>> : std::integral_constant<FusedOrder, FusedOrder::SIEVE> { };
+
+// A Cache whose primary store is built in, so that each entry holds its value
+// together with the state of the evict and write policies: the links of its
+// place in eviction order, a reference bit and a dirty bit. A hit is a single
+// hash lookup, which finds all of these in one node.
+//
+// The evict policy selects the order in which entries are evicted: Lru and
+// HashLru evict the least recently used entry, Clock sweeps a hand over
+// entries in the order they were added, and Sieve sweeps over entries in
+// insertion order, keeping those which were touched since the hand last
+// passed. With a WriteBack write policy, dirty values are marked in place
+// rather than kept in a separate map, and are written to the backing store in
+// one batch per eviction. Other read and write policies are used as they are
+// by Cache.
+template <typename S2,
+          typename E = Lru<S2>,
+          typename R = Fetch<S2>,
+          typename W = WriteBack<S2>,
+          typename H = std::hash<typename std::remove_const<typename S2::k_type>::type>>
+class FusedCache {
+  private:
+    typedef typename std::remove_const<typename S2::k_type>::type key_type;
+    typedef typename S2::value_type entry_type;
+    typedef typename std::aligned_storage<sizeof(entry_type), alignof(entry_type)>::type slot_type;
+
+    // Entries are kept in a circular list through a sentinel. Lru keeps the
+    // most recently used entry at the front, Sieve the most recently added,
+    // and Clock adds entries just behind its hand.
+    struct Link {
+      Link* prev;
+      Link* next;
+    };
+    struct Node : Link {
+      Node* chain;
+      size_t hash;
+      bool ref;
+      bool dirty;
+      slot_type slot;
+
+      entry_type* value() {
+        return reinterpret_cast<entry_type*>(&slot);
+      }
+      const entry_type* value() const {
+        return reinterpret_cast<const entry_type*>(&slot);
+      }
+    };
+
+  public:
+    template <bool is_const>
+    class Iterator {
+      friend class FusedCache;
+      template <bool> friend class Iterator;
+
+      // TYPES:
+      public:
+        typedef typename FusedCache::value_type value_type;
+        typedef typename std::conditional<is_const, const value_type&, value_type&>::type reference;
+        typedef typename std::conditional<is_const, const value_type*, value_type*>::type pointer;
+        typedef typename FusedCache::difference_type difference_type;
+        typedef typename std::forward_iterator_tag iterator_category;
+
+      // CONSTRUCT/COPY/DESTROY:
+      private:
+        explicit Iterator(Link* l) : l_(l) { }
+      public:
+        Iterator() : l_(nullptr) { }
+        Iterator(const Iterator& rhs) = default;
+        template <bool c = is_const, typename = typename std::enable_if<c>::type>
+        Iterator(const Iterator<false>& rhs) : l_(rhs.l_) { }
+        Iterator& operator=(const Iterator& rhs) = default;
+
+        // ABILITIES:
+        reference operator*() const {
+          return *static_cast<Node*>(l_)->value();
+        }
+        pointer operator->() const {
+          return static_cast<Node*>(l_)->value();
+        }
+        Iterator& operator++() {
+          l_ = l_->next;
+          return *this;
+        }
+        Iterator operator++(int) {
+          auto ret = *this;
+          ++(*this);
+          return ret;
+        }
+        bool operator==(const Iterator& rhs) const {
+          return l_ == rhs.l_;
+        }
+        bool operator!=(const Iterator& rhs) const {
+          return !(*this == rhs);
+        }
+
+      private:
+        Link* l_;
+    };
+
+    // TYPES:
+    // Container:
+    typedef entry_type value_type;
+    typedef value_type& reference;
+    typedef const value_type& const_reference;
+    typedef Iterator<false> iterator;
+    typedef Iterator<true> const_iterator;
+    typedef ptrdiff_t difference_type;
+    typedef size_t size_type;
+    // Other:
+    typedef typename S2::k_type k_type;
+    typedef typename S2::v_type v_type;
+
+    // CONSTRUCT/COPY/DESTROY:
+    // Container:
+    FusedCache(S2* s2 = nullptr, size_t c = 16) :
+        s2_(s2), capacity_(c), low_(std::numeric_limits<size_t>::max()),
+        head_(new Link), hand_(nullptr), fresh_(nullptr), free_(nullptr), size_(0) {
+      head_->prev = head_->next = head_;
+    }
+    FusedCache(const FusedCache& rhs) :
+        s2_(rhs.s2_), capacity_(rhs.capacity_), low_(rhs.low_), r_(rhs.r_), w_(rhs.w_),
+        head_(new Link), hand_(nullptr), fresh_(nullptr), free_(nullptr), size_(0) {
+      head_->prev = head_->next = head_;
+      reserve(rhs.size_);
+      // Back to front, so that each copy is added at the front
+      Link* hand = nullptr;
+      for (auto l = rhs.head_->prev; l != rhs.head_; l = l->prev) {
+        const auto n = static_cast<const Node*>(l);
+        auto m = insert(n->hash, *n->value());
+        m->ref = n->ref;
+        m->dirty = n->dirty;
+        if (l == rhs.hand_) {
+          hand = m;
+        }
+      }
+      hand_ = hand;
+    }
+    FusedCache(FusedCache&& rhs) : FusedCache() {
+      swap(rhs);
+    }
+    FusedCache& operator=(FusedCache rhs) {
+      swap(rhs);
+      return *this;
+    }
+    ~FusedCache() {
+      destroy();
+      delete head_;
+    }
+
+    // ITERATORS:
+    // Container:
+    iterator begin() {
+      return iterator(head_->next);
+    }
+    const_iterator begin() const {
+      return const_iterator(head_->next);
+    }
+    iterator end() {
+      return iterator(head_);
+    }
+    const_iterator end() const {
+      return const_iterator(head_);
+    }
+    const_iterator cbegin() const {
+      return const_iterator(head_->next);
+    }
+    const_iterator cend() const {
+      return const_iterator(head_);
+    }
+
+    // CAPACITY:
+    // Container:
+    bool empty() const {
+      return size_ == 0;
+    }
+    size_type size() const {
+      return size_;
+    }
+    size_type max_size() const {
+      return capacity_;
+    }
+
+    // MODIFIERS:
+    // Container:
+    void swap(FusedCache& rhs) {
+      using std::swap;
+      swap(s2_, rhs.s2_);
+      swap(capacity_, rhs.capacity_);
+      swap(low_, rhs.low_);
+      swap(r_, rhs.r_);
+      swap(w_, rhs.w_);
+      swap(buckets_, rhs.buckets_);
+      swap(head_, rhs.head_);
+      swap(hand_, rhs.hand_);
+      swap(fresh_, rhs.fresh_);
+      swap(free_, rhs.free_);
+      swap(size_, rhs.size_);
+    }
+
+    // STORE INTERFACE:
+    // Common:
+    bool contains(const k_type& k) {
+      return find(k) != nullptr;
+    }
+    v_type get(const k_type& k) {
+      if (s2_ == nullptr) {
+        return v_type();
+      }
+      if (auto n = find(k)) {
+        touch(n);
+        return n->value()->second;
+      }
+
+      // As in Cache, the write policy may still hold a newer value than s2
+      typename std::remove_const<v_type>::type q;
+      if (!back && binder::queued(w_, k, q)) {
+        assign(value_type(k, q), false);
+        resize(max_size());
+        return q;
+      }
+
+      r_.fetch(*s2_, k);
+      fill();
+      for (auto v = r_.begin(), ve = r_.end(); v != ve; ++v) {
+        if (v->first == k) {
+          return v->second;
+        }
+      }
+      return v_type();
+    }
+    void put(const value_type& v) {
+      if (s2_ != nullptr) {
+        invalidate(r_, v.first);
+        if (!back) {
+          w_.modify(*s2_, v);
+        }
+        assign(v, back);
+        resize(max_size());
+      }
+    }
+    void erase(const k_type& k) {
+      if (s2_ != nullptr) {
+        if (!back) {
+          w_.flush(*s2_, k);
+        }
+        if (auto n = find(k)) {
+          unlink(n);
+          if (n->dirty) {
+            s2_->put(*n->value());
+          }
+          release(n);
+        }
+      }
+    }
+    void clear() {
+      resize(0);
+    }
+    // Batched:
+    template <typename KItr, typename OItr>
+    void multi_get(KItr begin, KItr end, OItr out) {
+      if (s2_ == nullptr) {
+        for (; begin != end; ++begin) {
+          *out++ = v_type();
+        }
+        return;
+      }
+
+      std::vector<typename std::remove_const<v_type>::type> vs;
+      std::vector<key_type> misses;
+      std::vector<size_t> idx;
+      typename std::remove_const<v_type>::type q;
+      for (auto k = begin; k != end; ++k) {
+        if (auto n = find(*k)) {
+          touch(n);
+          vs.push_back(n->value()->second);
+        } else if (!back && binder::queued(w_, *k, q)) {
+          vs.push_back(q);
+          assign(value_type(*k, q), false);
+          resize(max_size());
+        } else {
+          idx.push_back(vs.size());
+          misses.push_back(*k);
+          vs.push_back(v_type());
+        }
+      }
+      if (!misses.empty()) {
+        r_.fetch(*s2_, misses.begin(), misses.end());
+        fill();
+
+        // As in Cache, results are read from the fetch
+        match(r_.begin(), r_.end(), misses.begin(), misses.end(), [&](size_t i, const v_type& v) {
+          vs[idx[i]] = v;
+        });
+      }
+
+      for (const auto& v : vs) {
+        *out++ = v;
+      }
+    }
+    template <typename VItr>
+    void multi_put(VItr begin, VItr end) {
+      if (s2_ != nullptr) {
+        if (!back) {
+          w_.modify(*s2_, begin, end);
+        }
+        for (auto v = begin; v != end; ++v) {
+          invalidate(r_, v->first);
+          assign(*v, back);
+          resize(max_size());
+        }
+      }
+    }
+    template <typename KItr>
+    void multi_erase(KItr begin, KItr end) {
+      if (s2_ != nullptr) {
+        if (!back) {
+          w_.flush(*s2_, begin, end);
+        }
+        std::vector<Node*> ns;
+        for (; begin != end; ++begin) {
+          if (auto n = find(*begin)) {
+            unlink(n);
+            ns.push_back(n);
+          }
+        }
+        flush(ns);
+      }
+    }
+    // FusedCache:
+    void capacity(size_t c) {
+      capacity_ = c;
+      resize(max_size());
+    }
+    // As Cache::watermark()
+    void watermark(size_t low) {
+      low_ = low;
+      resize(max_size());
+    }
+    void reserve(size_t n) {
+      size_t b = 16;
+      while (b < n) {
+        b *= 2;
+      }
+      if (b > buckets_.size()) {
+        rehash(b);
+      }
+    }
+    S2* backing_store(S2* s2 = nullptr) {
+      auto ret = s2_;
+      if (s2 != nullptr) {
+        clear();
+        s2_ = s2;
+      }
+      return ret;
+    }
+
+    // COMPARISON:
+    // Container:
+    friend bool operator==(const FusedCache& lhs, const FusedCache& rhs) {
+      if (lhs.size_ != rhs.size_) {
+        return false;
+      }
+      for (const auto& v : lhs) {
+        const auto n = rhs.find(v.first);
+        if (n == nullptr || !(n->value()->second == v.second)) {
+          return false;
+        }
+      }
+      return true;
+    }
+    friend bool operator!=(const FusedCache& lhs, const FusedCache& rhs) {
+      return !(lhs == rhs);
+    }
+
+    // SPECIALIZED ALGORITHMS:
+    // Container:
+    friend void swap(FusedCache& lhs, FusedCache& rhs) {
+      lhs.swap(rhs);
+    }
+
+  private:
+    static constexpr FusedOrder order = FusedEvict<E>::value;
+    // Whether dirty values are marked in place rather than handed to w_
+    static constexpr bool back = std::is_same<W, WriteBack<S2>>::value;
+
+    S2* s2_;
+    size_t capacity_;
+    size_t low_;
+    R r_;
+    W w_;
+    // Chains of entries by hash, a power of two in number
+    std::vector<Node*> buckets_;
+    Link* head_;
+    // Where Clock and Sieve resume sweeping, or null to start at the oldest
+    Link* hand_;
+    // The entry added last, which is passed over when making room for it
+    Node* fresh_;
+    // Released nodes, chained for reuse
+    Node* free_;
+    size_t size_;
+
+    static size_t hash(const k_type& k) {
+      // As in FlatStore, mix so that the low bits used for buckets are spread
+      uint64_t h = H()(k);
+      h ^= h >> 33;
+      h *= 0xff51afd7ed558ccdull;
+      h ^= h >> 33;
+      return h;
+    }
+    Node* find(const k_type& k) const {
+      if (buckets_.empty()) {
+        return nullptr;
+      }
+      const auto h = hash(k);
+      for (auto n = buckets_[h & (buckets_.size()-1)]; n != nullptr; n = n->chain) {
+        if (n->hash == h && n->value()->first == k) {
+          return n;
+        }
+      }
+      return nullptr;
+    }
+
+    // Puts v, marking it dirty if it is to be written back. A new entry takes
+    // its place in eviction order, and an existing one is touched.
+    void assign(const value_type& v, bool dirty) {
+      const auto h = hash(v.first);
+      auto n = find(v.first);
+      if (n != nullptr) {
+        n->value()->~value_type();
+        new (&n->slot) value_type(v);
+        n->dirty = n->dirty || dirty;
+        touch(n);
+      } else {
+        n = insert(h, v);
+        n->dirty = dirty;
+        fresh_ = n;
+      }
+    }
+    // Adds a new entry, clean and unreferenced, at the front of the list or,
+    // for Clock, just behind the hand
+    Node* insert(size_t h, const value_type& v) {
+      if (size_ + 1 > buckets_.size()) {
+        rehash(buckets_.empty() ? 16 : 2 * buckets_.size());
+      }
+      Node* n;
+      if (free_ != nullptr) {
+        n = free_;
+        free_ = free_->chain;
+      } else {
+        n = new Node;
+      }
+      new (&n->slot) value_type(v);
+      n->hash = h;
+      n->ref = false;
+      n->dirty = false;
+      auto& b = buckets_[h & (buckets_.size()-1)];
+      n->chain = b;
+      b = n;
+
+      const auto at = order == FusedOrder::CLOCK && hand_ != nullptr ? hand_ : head_;
+      n->prev = at;
+      n->next = at->next;
+      at->next->prev = n;
+      at->next = n;
+      ++size_;
+      return n;
+    }
+    void touch(Node* n) {
+      if (order == FusedOrder::LRU) {
+        n->prev->next = n->next;
+        n->next->prev = n->prev;
+        n->prev = head_;
+        n->next = head_->next;
+        head_->next->prev = n;
+        head_->next = n;
+      } else {
+        n->ref = true;
+      }
+    }
+    // Selects the next entry to evict. Clock and Sieve leave their hand on
+    // it, so that unlinking it moves the hand on to the next entry.
+    Node* victim() {
+      if (order == FusedOrder::LRU) {
+        const auto n = static_cast<Node*>(head_->prev);
+        return n == fresh_ && size_ > 1 ? static_cast<Node*>(n->prev) : n;
+      }
+      // The hand sweeps from oldest to newest and wraps around
+      auto l = hand_ != nullptr ? hand_ : head_->prev;
+      for (;; l = l->prev != head_ ? l->prev : head_->prev) {
+        const auto n = static_cast<Node*>(l);
+        if (n == fresh_ && size_ > 1) {
+          continue;
+        }
+        if (n->ref) {
+          n->ref = false;
+          continue;
+        }
+        hand_ = n;
+        return n;
+      }
+    }
+    // Removes n from its chain and from the list, moving the hand past it
+    void unlink(Node* n) {
+      auto p = &buckets_[n->hash & (buckets_.size()-1)];
+      for (; *p != n; p = &(*p)->chain);
+      *p = n->chain;
+      if (hand_ == n) {
+        hand_ = n->prev != head_ ? n->prev : nullptr;
+      }
+      if (fresh_ == n) {
+        fresh_ = nullptr;
+      }
+      n->prev->next = n->next;
+      n->next->prev = n->prev;
+      --size_;
+    }
+    void release(Node* n) {
+      n->value()->~value_type();
+      n->chain = free_;
+      free_ = n;
+    }
+    // Writes back those of ns which are dirty in one batch, then releases them
+    void flush(const std::vector<Node*>& ns) {
+      std::vector<value_type> dirty;
+      for (auto n : ns) {
+        if (n->dirty) {
+          dirty.push_back(*n->value());
+        }
+      }
+      binder::multi_put(*s2_, dirty.begin(), dirty.end());
+      for (auto n : ns) {
+        release(n);
+      }
+    }
+
+    // Moves the results of the last fetch into the cache. These values are
+    // already in s2, so they are clean.
+    void fill() {
+      for (auto v = r_.begin(), ve = r_.end(); v != ve; ++v) {
+        assign(*v, false);
+        resize(max_size());
+      }
+    }
+    // As Cache::resize(), evicting down to the low watermark once there are
+    // more than s entries, or everything if s is 0
+    void resize(size_t s) {
+      if (s2_ == nullptr || empty() || (s != 0 && size_ <= s)) {
+        return;
+      }
+      const auto low = std::min(low_, s);
+      std::vector<Node*> ns;
+      std::vector<key_type> ks;
+      while (size_ > 0 && (low == 0 || size_ > low)) {
+        const auto n = victim();
+        unlink(n);
+        ns.push_back(n);
+        if (!back) {
+          ks.push_back(n->value()->first);
+        }
+      }
+      if (!back) {
+        w_.flush(*s2_, ks.begin(), ks.end());
+      }
+      flush(ns);
+    }
+    void rehash(size_t b) {
+      std::vector<Node*> buckets(b, nullptr);
+      for (auto l = head_->next; l != head_; l = l->next) {
+        const auto n = static_cast<Node*>(l);
+        auto& c = buckets[n->hash & (b-1)];
+        n->chain = c;
+        c = n;
+      }
+      buckets_.swap(buckets);
+    }
+    void destroy() {
+      for (auto l = head_->next; l != head_; ) {
+        const auto n = static_cast<Node*>(l);
+        l = l->next;
+        n->value()->~value_type();
+        delete n;
+      }
+      while (free_ != nullptr) {
+        const auto n = free_;
+        free_ = free_->chain;
+        delete n;
+      }
+    }
+};
+
+} // namespace binder
+
+#endif
@@ -0,0 +1,851 @@
+#ifndef BINDER_INCLUDE_LOG_H
+#define BINDER_INCLUDE_LOG_H
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "include/codec.h"
+
+namespace binder {
+
+// When the records appended by a LogStore are synced to disk. flush() and
+// close() always sync.
+enum class LogSync {
+  // Never otherwise. Records wait in process memory until their group is
+  // written, so a process crash loses those, and a system crash also loses
+  // whatever the kernel hadn't written back.
+  NONE,
+  // After each group of records is written. A group is written once it is
+  // large enough, or by a background thread once its first record has waited
+  // long enough; a crash loses at most that group.
+  GROUP,
+  // Before each modifier returns
+  EACH
+};
+
+// A store kept in an append-only file on local disk. Each put or erase
+// appends a record, and an index in memory holds the offset of the live
+// record for every key, so that a get is one read. Records are buffered and
+// written in groups of (by default) 64KB or 10ms, and synced according to a
+// LogSync policy. Opening a file replays it to rebuild the index, and truncates a
+// record left incomplete by a crash.
+//
+// Once enough of the file is overwritten or erased records, a background
+// thread copies the live records into a new file, which then replaces the
+// old one. Copied records are switched over in batches, so gets and puts
+// continue throughout, and only records appended while it ran are copied
+// in the final step.
+template <typename K, typename V, typename IO = Binary<K,V>, typename H = std::hash<K>>
+class LogStore {
+  private:
+    typedef Codec<K, V, IO> codec;
+    typedef std::chrono::steady_clock clock;
+
+    // Each record is a header followed by the encoded key and value. An
+    // erase is recorded as a key without a value.
+    struct Record {
+      uint32_t klen;
+      uint32_t vlen;
+      uint32_t checksum;
+    };
+    static constexpr uint32_t ERASED = std::numeric_limits<uint32_t>::max();
+    // Compaction copies live records in batches of about this many bytes
+    static constexpr size_t BATCH = 1 << 20;
+
+    // The live record for a key, in the current file or (during
+    // compaction) the one replacing it
+    struct Entry {
+      uint64_t offset;
+      uint32_t klen;
+      uint32_t vlen;
+      uint32_t file;
+    };
+    typedef std::unordered_map<K, Entry, H> index_type;
+    // A live record copied by compaction
+    struct Move {
+      K k;
+      uint64_t from;
+      uint64_t to;
+    };
+
+    static uint64_t length(uint32_t klen, uint32_t vlen) {
+      return sizeof(Record) + klen + (vlen == ERASED ? 0 : vlen);
+    }
+    // FNV-1a over the lengths and contents of a record
+    static uint32_t checksum(const Record& r, const char* data) {
+      uint32_t res = 2166136261u;
+      const auto hash = [&res](const char* p, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+          res = (res ^ (unsigned char)p[i]) * 16777619u;
+        }
+      };
+      hash((const char*)&r, offsetof(Record, checksum));
+      hash(data, length(r.klen, r.vlen) - sizeof(Record));
+      return res;
+    }
+
+    // Reads the records in [begin, end) of a file in order
+    class Scanner {
+      public:
+        Scanner(int fd, uint64_t begin, uint64_t end) : fd_(fd), pos_(begin), end_(end), len_(0), base_(begin) { }
+
+        // Moves to the next record. Returns false at the end of the range,
+        // or at a record which is incomplete or fails its checksum.
+        bool next() {
+          pos_ += len_;
+          len_ = 0;
+          if (!fill(sizeof(Record))) {
+            return false;
+          }
+          std::memcpy(&rec_, buf_.data() + (pos_ - base_), sizeof(Record));
+          const auto n = LogStore::length(rec_.klen, rec_.vlen);
+          if (!fill(n) || checksum(rec_, key()) != rec_.checksum) {
+            return false;
+          }
+          len_ = n;
+          return true;
+        }
+        uint64_t offset() const {
+          return pos_;
+        }
+        bool erased() const {
+          return rec_.vlen == ERASED;
+        }
+        const Record& record() const {
+          return rec_;
+        }
+        const char* data() const {
+          return buf_.data() + (pos_ - base_);
+        }
+        uint64_t length() const {
+          return len_;
+        }
+        const char* key() const {
+          return data() + sizeof(Record);
+        }
+
+      private:
+        int fd_;
+        uint64_t pos_;
+        uint64_t end_;
+        uint64_t len_;
+        // The bytes of the file from base_
+        std::string buf_;
+        uint64_t base_;
+        Record rec_;
+
+        // Ensures that the n bytes from pos_ are buffered
+        bool fill(uint64_t n) {
+          if (pos_ + n > end_) {
+            return false;
+          }
+          if (pos_ + n <= base_ + buf_.size()) {
+            return true;
+          }
+          const auto size = std::min(end_ - pos_, std::max(n, (uint64_t)BATCH));
+          buf_.resize(size);
+          base_ = pos_;
+          return read_all(fd_, &buf_[0], size, pos_);
+        }
+    };
+
+  public:
+    template <bool is_const>
+    class Iterator {
+      friend class LogStore;
+      template <bool> friend class Iterator;
+
+      // TYPES:
+      public:
+        typedef typename LogStore::value_type value_type;
+        typedef typename std::conditional<is_const, const value_type&, value_type&>::type reference;
+        typedef typename std::conditional<is_const, const value_type*, value_type*>::type pointer;
+        typedef typename LogStore::difference_type difference_type;
+        typedef typename std::forward_iterator_tag iterator_category;
+
+      // CONSTRUCT/COPY/DESTROY:
+      private:
+        Iterator(typename index_type::const_iterator itr, LogStore* s) : itr_(itr), s_(s), cached_(false) { }
+      public:
+        Iterator() : s_(nullptr), cached_(false) { }
+        Iterator(const Iterator& rhs) : itr_(rhs.itr_), s_(rhs.s_), cached_(false) { }
+        template <bool c = is_const, typename = typename std::enable_if<c>::type>
+        Iterator(const Iterator<false>& rhs) : itr_(rhs.itr_), s_(rhs.s_), cached_(false) { }
+        Iterator& operator=(const Iterator& rhs) {
+          reset();
+          itr_ = rhs.itr_;
+          s_ = rhs.s_;
+          return *this;
+        }
+        ~Iterator() {
+          reset();
+        }
+
+        // ABILITIES:
+        reference operator*() const {
+          return *get();
+        }
+        pointer operator->() const {
+          return get();
+        }
+        Iterator& operator++() {
+          reset();
+          ++itr_;
+          return *this;
+        }
+        Iterator operator++(int) {
+          auto ret = *this;
+          ++(*this);
+          return ret;
+        }
+        bool operator==(const Iterator& rhs) const {
+          return itr_ == rhs.itr_;
+        }
+        bool operator!=(const Iterator& rhs) const {
+          return !(*this == rhs);
+        }
+
+      private:
+        typedef typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type slot_type;
+
+        typename index_type::const_iterator itr_;
+        LogStore* s_;
+        // The value at itr_, read on first dereference and kept until the
+        // iterator moves
+        mutable slot_type val_;
+        mutable bool cached_;
+
+        value_type* get() const {
+          if (!cached_) {
+            new (&val_) value_type(itr_->first, s_->read(itr_));
+            cached_ = true;
+          }
+          return reinterpret_cast<value_type*>(&val_);
+        }
+        void reset() {
+          if (cached_) {
+            reinterpret_cast<value_type*>(&val_)->~value_type();
+            cached_ = false;
+          }
+        }
+    };
+
+    // TYPES:
+    // Container:
+    typedef std::pair<const K, const V> value_type;
+    typedef value_type& reference;
+    typedef const value_type& const_reference;
+    typedef Iterator<false> iterator;
+    typedef Iterator<true> const_iterator;
+    typedef ptrdiff_t difference_type;
+    typedef size_t size_type;
+    // Other:
+    typedef K k_type;
+    typedef V v_type;
+
+    // CONSTRUCT/COPY/DESTROY:
+    // Container:
+    LogStore() : fd_(-1), cfd_(-1), file_(0), written_(0), live_(0), sync_(LogSync::GROUP),
+        group_(1 << 16), delay_(std::chrono::milliseconds(10)), ratio_(0.5), min_(1 << 20),
+        compacting_(false), stop_(false) { }
+    // Two stores may not append to the same file
+    LogStore(const LogStore& rhs) = delete;
+    LogStore(LogStore&& rhs) : LogStore() {
+      swap(rhs);
+    }
+    LogStore& operator=(LogStore rhs) {
+      swap(rhs);
+      return *this;
+    }
+    ~LogStore() {
+      close();
+      {
+        std::lock_guard<std::mutex> l(m_);
+        stop_ = true;
+      }
+      due_.notify_one();
+      if (timer_.joinable()) {
+        timer_.join();
+      }
+    }
+    // LogStore:
+    LogStore(const std::string& path, LogSync sync = LogSync::GROUP) : LogStore() {
+      sync_ = sync;
+      open(path);
+    }
+
+    // ITERATORS:
+    // Container:
+    iterator begin() {
+      return iterator(index_.cbegin(), this);
+    }
+    const_iterator begin() const {
+      return const_iterator(index_.cbegin(), const_cast<LogStore*>(this));
+    }
+    iterator end() {
+      return iterator(index_.cend(), this);
+    }
+    const_iterator end() const {
+      return const_iterator(index_.cend(), const_cast<LogStore*>(this));
+    }
+    const_iterator cbegin() const {
+      return begin();
+    }
+    const_iterator cend() const {
+      return end();
+    }
+
+    // CAPACITY:
+    // Container:
+    bool empty() const {
+      return size() == 0;
+    }
+    size_type size() const {
+      std::lock_guard<std::mutex> l(m_);
+      return index_.size();
+    }
+    size_type max_size() const {
+      return index_.max_size();
+    }
+
+    // MODIFIERS:
+    // Container:
+    void swap(LogStore& rhs) {
+      using std::swap;
+      wait();
+      rhs.wait();
+      // Each store keeps its own timer, which must not see the swap halfway
+      std::unique_lock<std::mutex> l(m_, std::defer_lock);
+      std::unique_lock<std::mutex> rl(rhs.m_, std::defer_lock);
+      std::lock(l, rl);
+      swap(path_, rhs.path_);
+      swap(fd_, rhs.fd_);
+      swap(cfd_, rhs.cfd_);
+      swap(file_, rhs.file_);
+      swap(index_, rhs.index_);
+      swap(pending_, rhs.pending_);
+      swap(written_, rhs.written_);
+      swap(live_, rhs.live_);
+      swap(sync_, rhs.sync_);
+      swap(group_, rhs.group_);
+      swap(delay_, rhs.delay_);
+      swap(first_, rhs.first_);
+      swap(ratio_, rhs.ratio_);
+      swap(min_, rhs.min_);
+      arm();
+      rhs.arm();
+      due_.notify_one();
+      rhs.due_.notify_one();
+    }
+
+    // STORE INTERFACE:
+    // Common:
+    bool contains(const k_type& k) {
+      std::lock_guard<std::mutex> l(m_);
+      return index_.find(k) != index_.end();
+    }
+    v_type get(const k_type& k) {
+      std::lock_guard<std::mutex> l(m_);
+      const auto itr = index_.find(k);
+      return itr == index_.end() ? V() : read(itr->second);
+    }
+    void put(const value_type& v) {
+      std::lock_guard<std::mutex> l(m_);
+      if (!is_open()) {
+        return;
+      }
+      append(v.first, &v.second);
+      commit();
+    }
+    void erase(const k_type& k) {
+      std::lock_guard<std::mutex> l(m_);
+      if (index_.find(k) == index_.end()) {
+        return;
+      }
+      append(k, nullptr);
+      commit();
+    }
+    void clear() {
+      wait();
+      std::lock_guard<std::mutex> l(m_);
+      if (!is_open()) {
+        return;
+      }
+      index_.clear();
+      pending_.clear();
+      if (ftruncate(fd_, 0) == 0) {
+        written_ = 0;
+        live_ = 0;
+        sync();
+      }
+    }
+    // Batched:
+    // Records are appended and committed as one group
+    template <typename VItr>
+    void multi_put(VItr begin, VItr end) {
+      std::lock_guard<std::mutex> l(m_);
+      if (!is_open()) {
+        return;
+      }
+      for (; begin != end; ++begin) {
+        append(begin->first, &begin->second);
+      }
+      commit();
+    }
+    template <typename KItr>
+    void multi_erase(KItr begin, KItr end) {
+      std::lock_guard<std::mutex> l(m_);
+      if (!is_open()) {
+        return;
+      }
+      for (; begin != end; ++begin) {
+        if (index_.find(*begin) != index_.end()) {
+          append(*begin, nullptr);
+        }
+      }
+      commit();
+    }
+    // LogStore:
+    // Replays the log in path, creating it if it doesn't exist
+    void open(const std::string& path) {
+      close();
+      const auto fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+      if (fd < 0) {
+        return;
+      }
+      struct stat st;
+      if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return;
+      }
+      std::lock_guard<std::mutex> l(m_);
+      path_ = path;
+      fd_ = fd;
+      Scanner s(fd_, 0, st.st_size);
+      while (s.next()) {
+        replay(s);
+      }
+      written_ = s.offset() + s.length();
+      if (written_ < (uint64_t)st.st_size && ftruncate(fd_, written_) == 0) {
+        sync();
+      }
+    }
+    bool is_open() const {
+      return fd_ >= 0;
+    }
+    // Writes and syncs buffered records
+    void flush() {
+      std::lock_guard<std::mutex> l(m_);
+      if (!is_open()) {
+        return;
+      }
+      write();
+      sync();
+    }
+    // Waits for compaction, then flushes and closes the file
+    void close() {
+      wait();
+      std::lock_guard<std::mutex> l(m_);
+      if (!is_open()) {
+        return;
+      }
+      write();
+      sync();
+      ::close(fd_);
+      path_.clear();
+      fd_ = -1;
+      index_.clear();
+      written_ = 0;
+      live_ = 0;
+    }
+    void set_sync(LogSync sync) {
+      std::lock_guard<std::mutex> l(m_);
+      sync_ = sync;
+    }
+    // The number of bytes buffered, or the time the first of them waits,
+    // before records are written
+    void set_group_size(size_t bytes, clock::duration delay = std::chrono::milliseconds(10)) {
+      std::lock_guard<std::mutex> l(m_);
+      group_ = bytes;
+      delay_ = delay;
+      due_.notify_one();
+    }
+    // Compacts in the background once the file is at least min bytes, of
+    // which more than ratio are dead records. A ratio of 1 or more disables
+    // automatic compaction.
+    void set_compaction(double ratio, size_t min = 1 << 20) {
+      ratio_ = ratio;
+      min_ = min;
+    }
+    // Starts compacting in the background, unless already compacting
+    void compact() {
+      std::lock_guard<std::mutex> l(m_);
+      if (is_open() && !compacting_) {
+        start();
+      }
+    }
+    bool is_compacting() const {
+      return compacting_;
+    }
+    // Blocks until a running compaction completes
+    void wait() {
+      if (compactor_.joinable()) {
+        compactor_.join();
+      }
+    }
+    // The length of the log, including buffered records
+    size_t file_size() const {
+      std::lock_guard<std::mutex> l(m_);
+      return written_ + pending_.size();
+    }
+    const std::string& path() const {
+      return path_;
+    }
+
+    // COMPARISON:
+    // Container:
+    friend bool operator==(const LogStore& lhs, const LogStore& rhs) {
+      if (lhs.size() != rhs.size()) {
+        return false;
+      }
+      auto& r = const_cast<LogStore&>(rhs);
+      for (const auto& v : lhs) {
+        if (!r.contains(v.first) || !(r.get(v.first) == v.second)) {
+          return false;
+        }
+      }
+      return true;
+    }
+    friend bool operator!=(const LogStore& lhs, const LogStore& rhs) {
+      return !(lhs == rhs);
+    }
+
+    // SPECIALIZED ALGORITHMS:
+    // Container:
+    friend void swap(LogStore& lhs, LogStore& rhs) {
+      lhs.swap(rhs);
+    }
+
+  private:
+    std::string path_;
+    int fd_;
+    // The file being compacted into, and the number of the current file,
+    // which the index uses to tell them apart
+    int cfd_;
+    uint32_t file_;
+    index_type index_;
+    // Records not yet written, which follow the written_ bytes of the file
+    std::string pending_;
+    uint64_t written_;
+    // The total length of the records in the index
+    uint64_t live_;
+    LogSync sync_;
+    size_t group_;
+    clock::duration delay_;
+    // When the first record in pending_ was appended
+    clock::time_point first_;
+    double ratio_;
+    size_t min_;
+    // Guards everything above against the compactor and the timer
+    mutable std::mutex m_;
+    std::thread compactor_;
+    std::atomic<bool> compacting_;
+    // Writes groups which have waited delay_, started with the first group
+    // which isn't written at once. due_ is signalled when a group begins.
+    std::thread timer_;
+    std::condition_variable due_;
+    bool stop_;
+    // Scratch buffers for encoding and reading
+    std::string kbuf_;
+    std::string vbuf_;
+    std::string rbuf_;
+
+    static bool read_all(int fd, char* buf, size_t n, uint64_t offset) {
+      while (n > 0) {
+        const auto res = pread(fd, buf, n, offset);
+        if (res <= 0) {
+          return false;
+        }
+        buf += res;
+        n -= res;
+        offset += res;
+      }
+      return true;
+    }
+    static bool write_all(int fd, const char* buf, size_t n, uint64_t offset) {
+      while (n > 0) {
+        const auto res = pwrite(fd, buf, n, offset);
+        if (res <= 0) {
+          return false;
+        }
+        buf += res;
+        n -= res;
+        offset += res;
+      }
+      return true;
+    }
+
+    // Reads the value of the record for e. Records past written_ haven't
+    // yet left pending_.
+    V read(const Entry& e) {
+      const auto offset = e.offset + sizeof(Record) + e.klen;
+      if (offset >= written_ && e.file == file_) {
+        return codec::vread(pending_.data() + (offset - written_), e.vlen);
+      }
+      rbuf_.resize(e.vlen);
+      if (!read_all(e.file == file_ ? fd_ : cfd_, &rbuf_[0], e.vlen, offset)) {
+        return V();
+      }
+      return codec::vread(rbuf_.data(), e.vlen);
+    }
+    V read(typename index_type::const_iterator itr) {
+      std::lock_guard<std::mutex> l(m_);
+      return read(itr->second);
+    }
+
+    // Buffers a record which puts *v, or erases k if v is null
+    void append(const K& k, const V* v) {
+      codec::kwrite(kbuf_, k);
+      if (v != nullptr) {
+        codec::vwrite(vbuf_, *v);
+      }
+      Record r;
+      r.checksum = 0;
+      r.klen = kbuf_.size();
+      r.vlen = v == nullptr ? ERASED : vbuf_.size();
+      if (pending_.empty()) {
+        first_ = clock::now();
+        due_.notify_one();
+      }
+      const auto offset = written_ + pending_.size();
+      pending_.append((const char*)&r, sizeof(r));
+      pending_.append(kbuf_);
+      if (v != nullptr) {
+        pending_.append(vbuf_);
+      }
+      r.checksum = checksum(r, &pending_[offset - written_ + sizeof(r)]);
+      std::memcpy(&pending_[offset - written_], &r, sizeof(r));
+
+      auto itr = index_.find(k);
+      if (itr != index_.end()) {
+        live_ -= length(itr->second.klen, itr->second.vlen);
+        if (v == nullptr) {
+          index_.erase(itr);
+          return;
+        }
+      }
+      const Entry e = {offset, r.klen, r.vlen, file_};
+      if (itr != index_.end()) {
+        itr->second = e;
+      } else {
+        index_.emplace(k, e);
+      }
+      live_ += length(r.klen, r.vlen);
+    }
+    // Applies a record read from the log to the index
+    void replay(const Scanner& s) {
+      const auto& r = s.record();
+      const auto k = codec::kread(s.key(), r.klen);
+      auto itr = index_.find(k);
+      if (itr != index_.end()) {
+        live_ -= length(itr->second.klen, itr->second.vlen);
+        if (s.erased()) {
+          index_.erase(itr);
+          return;
+        }
+        itr->second = {s.offset(), r.klen, r.vlen, file_};
+      } else if (!s.erased()) {
+        index_.emplace(k, Entry{s.offset(), r.klen, r.vlen, file_});
+      } else {
+        return;
+      }
+      live_ += s.length();
+    }
+    // Writes buffered records as a group once there are enough of them, or
+    // the first has waited long enough, and otherwise leaves them to the timer
+    void commit() {
+      if (sync_ == LogSync::EACH || pending_.size() >= group_ ||
+          (!pending_.empty() && clock::now() - first_ >= delay_)) {
+        write();
+        if (sync_ != LogSync::NONE) {
+          sync();
+        }
+      }
+      arm();
+      const auto size = written_ + pending_.size();
+      if (!compacting_ && ratio_ < 1 && size >= min_ && size - live_ > ratio_ * size) {
+        start();
+      }
+    }
+    // Starts the timer if records are waiting and it isn't running. Called
+    // with m_ held.
+    void arm() {
+      if (!pending_.empty() && !timer_.joinable()) {
+        timer_ = std::thread(&LogStore::time, this);
+      }
+    }
+    // Runs on the timer thread, writing each group once its first record has
+    // waited delay_, so that records don't wait on the next modifier. A group
+    // which fails to write is retried after another delay_.
+    void time() {
+      std::unique_lock<std::mutex> l(m_);
+      while (!stop_) {
+        if (pending_.empty() || !is_open()) {
+          due_.wait(l);
+        } else if (clock::now() - first_ < delay_) {
+          due_.wait_until(l, first_ + delay_);
+        } else {
+          write();
+          if (sync_ != LogSync::NONE) {
+            sync();
+          }
+          if (!pending_.empty()) {
+            first_ = clock::now();
+          }
+        }
+      }
+    }
+    void write() {
+      if (!pending_.empty() && write_all(fd_, pending_.data(), pending_.size(), written_)) {
+        written_ += pending_.size();
+        pending_.clear();
+      }
+    }
+    void sync() {
+      fdatasync(fd_);
+    }
+
+    // Begins compacting the written log into path.compact. Called with m_
+    // held.
+    void start() {
+      write();
+      const auto fd = ::open((path_ + ".compact").c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+      if (fd < 0) {
+        return;
+      }
+      // A previous compactor has finished, but may not have been joined
+      wait();
+      cfd_ = fd;
+      compacting_ = true;
+      compactor_ = std::thread(&LogStore::compact_to, this, written_);
+    }
+    // Copies the live records among the first end bytes of the log, and then
+    // those appended since, into cfd_, before it replaces the log
+    void compact_to(uint64_t end) {
+      // The records copied in the current batch, and all those switched to
+      // the new file
+      std::vector<Move> batch;
+      std::vector<Move> moved;
+      std::string buf;
+      uint64_t size = 0;
+      bool ok = true;
+
+      Scanner s(fd_, 0, end);
+      while (ok && s.next()) {
+        if (s.erased()) {
+          continue;
+        }
+        auto k = codec::kread(s.key(), s.record().klen);
+        {
+          std::lock_guard<std::mutex> l(m_);
+          const auto itr = index_.find(k);
+          if (itr == index_.end() || itr->second.file != file_ || itr->second.offset != s.offset()) {
+            continue;
+          }
+        }
+        batch.push_back(Move{std::move(k), s.offset(), size + buf.size()});
+        buf.append(s.data(), s.length());
+        if (buf.size() >= BATCH) {
+          ok = copy(batch, moved, buf, size);
+        }
+      }
+      ok = ok && copy(batch, moved, buf, size);
+
+      std::lock_guard<std::mutex> l(m_);
+      write();
+      Scanner t(fd_, end, written_);
+      while (ok && t.next()) {
+        const auto& r = t.record();
+        auto k = codec::kread(t.key(), r.klen);
+        const auto itr = index_.find(k);
+        if (itr != index_.end() && itr->second.file == file_ && itr->second.offset == t.offset()) {
+          itr->second.offset = size + buf.size();
+          itr->second.file = file_ + 1;
+          moved.push_back(Move{std::move(k), t.offset(), itr->second.offset});
+        }
+        buf.append(t.data(), t.length());
+      }
+      ok = ok && write_all(cfd_, buf.data(), buf.size(), size) && fdatasync(cfd_) == 0 &&
+          std::rename((path_ + ".compact").c_str(), path_.c_str()) == 0;
+
+      if (ok) {
+        // Make the rename durable
+        const auto slash = path_.rfind('/');
+        const auto dir = ::open(slash == std::string::npos ? "." : path_.substr(0, slash + 1).c_str(), O_RDONLY);
+        if (dir >= 0) {
+          fsync(dir);
+          ::close(dir);
+        }
+        ::close(fd_);
+        fd_ = cfd_;
+        ++file_;
+        written_ = size + buf.size();
+      } else {
+        // Point the keys already switched back at their old records
+        for (const auto& m : moved) {
+          const auto itr = index_.find(m.k);
+          if (itr != index_.end() && itr->second.file == file_ + 1) {
+            itr->second.offset = m.from;
+            itr->second.file = file_;
+          }
+        }
+        ::close(cfd_);
+        std::remove((path_ + ".compact").c_str());
+      }
+      cfd_ = -1;
+      compacting_ = false;
+    }
+    // Writes a batch of live records to the end of cfd_, and then switches
+    // those which are still live over to it
+    bool copy(std::vector<Move>& batch, std::vector<Move>& moved, std::string& buf, uint64_t& size) {
+      if (!write_all(cfd_, buf.data(), buf.size(), size)) {
+        return false;
+      }
+      std::lock_guard<std::mutex> l(m_);
+      for (auto& m : batch) {
+        const auto itr = index_.find(m.k);
+        if (itr != index_.end() && itr->second.file == file_ && itr->second.offset == m.from) {
+          itr->second.offset = m.to;
+          itr->second.file = file_ + 1;
+          moved.push_back(std::move(m));
+        }
+      }
+      size += buf.size();
+      buf.clear();
+      batch.clear();
+      return true;
+    }
+};
+
+} // namespace binder
+
+#endif
@@ -0,0 +1,576 @@
+#ifndef BINDER_INCLUDE_MMAP_H
+#define BINDER_INCLUDE_MMAP_H
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace binder {
+
+// A persistent hash table in a memory-mapped file. Opening a file only maps
+// it, so startup takes the same time however much it holds, and pages are
+// read in by the kernel as they are first touched. Entries are stored as
+// their raw bytes, so keys and values must be trivially copyable and H must
+// hash the same way in every process which opens the file.
+//
+// The file begins with two copies of a header, each with a generation and a
+// checksum. checkpoint() flushes the table and then overwrites the older
+// copy, so a crash at any point leaves at least one valid header. Puts and
+// erases made since the last checkpoint reach the file when the kernel
+// writes back the pages they touched, in no particular order, so a crash
+// may keep some of them and lose others. The header records whether the
+// table was checkpointed, and if it was not, opening it drops full slots
+// whose control byte doesn't match their key and recounts the size. That
+// catches a control byte written without its slot, but not every torn
+// change: an erased key may reappear, or appear twice with different
+// values. Only the contents as of the last checkpoint are trustworthy.
+template <typename K, typename V, typename H = std::hash<K>>
+class MmapStore {
+  static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+      "MmapStore requires trivially copyable keys and values");
+
+  private:
+    // Control bytes: A full slot holds the low 7 bits of its key's hash with
+    // the high bit set. A new file reads as zeros, which are all EMPTY.
+    enum : uint8_t {
+      EMPTY = 0,
+      DELETED = 1,
+      SENTINEL = 2,
+      FULL = 0x80
+    };
+    static constexpr uint64_t MAGIC = 0x50414d4d444e4942ull;
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t PAGE = 4096;
+    static constexpr size_t MIN_CAPACITY = 16;
+
+    struct Header {
+      uint64_t magic;
+      uint32_t version;
+      uint32_t clean;
+      uint64_t ksize;
+      uint64_t vsize;
+      uint64_t capacity;
+      uint64_t size;
+      uint64_t deleted;
+      uint64_t generation;
+      uint64_t checksum;
+    };
+
+  public:
+    template <bool is_const>
+    class Iterator {
+      friend class MmapStore;
+      template <bool> friend class Iterator;
+
+      // TYPES:
+      public:
+        typedef typename MmapStore::value_type value_type;
+        typedef typename std::conditional<is_const, const value_type&, value_type&>::type reference;
+        typedef typename std::conditional<is_const, const value_type*, value_type*>::type pointer;
+        typedef typename MmapStore::difference_type difference_type;
+        typedef typename std::forward_iterator_tag iterator_category;
+
+      // CONSTRUCT/COPY/DESTROY:
+      private:
+        Iterator(const uint8_t* ctrl, value_type* slot) : ctrl_(ctrl), slot_(slot) {
+          skip();
+        }
+      public:
+        Iterator() : ctrl_(nullptr), slot_(nullptr) { }
+        Iterator(const Iterator& rhs) = default;
+        template <bool c = is_const, typename = typename std::enable_if<c>::type>
+        Iterator(const Iterator<false>& rhs) : ctrl_(rhs.ctrl_), slot_(rhs.slot_) { }
+        Iterator& operator=(const Iterator& rhs) = default;
+
+        // ABILITIES:
+        reference operator*() const {
+          return *slot_;
+        }
+        pointer operator->() const {
+          return slot_;
+        }
+        Iterator& operator++() {
+          ++ctrl_;
+          ++slot_;
+          skip();
+          return *this;
+        }
+        Iterator operator++(int) {
+          auto ret = *this;
+          ++(*this);
+          return ret;
+        }
+        bool operator==(const Iterator& rhs) const {
+          return ctrl_ == rhs.ctrl_;
+        }
+        bool operator!=(const Iterator& rhs) const {
+          return !(*this == rhs);
+        }
+
+      private:
+        const uint8_t* ctrl_;
+        value_type* slot_;
+
+        void skip() {
+          // The sentinel which follows the last slot stops this loop
+          for (; ctrl_ != nullptr && *ctrl_ < FULL && *ctrl_ != SENTINEL; ++ctrl_, ++slot_);
+        }
+    };
+
+    // TYPES:
+    // Container:
+    typedef std::pair<const K, const V> value_type;
+    typedef value_type& reference;
+    typedef const value_type& const_reference;
+    typedef Iterator<false> iterator;
+    typedef Iterator<true> const_iterator;
+    typedef ptrdiff_t difference_type;
+    typedef size_t size_type;
+    // Other:
+    typedef K k_type;
+    typedef const V v_type;
+
+    // CONSTRUCT/COPY/DESTROY:
+    // Container:
+    MmapStore() : fd_(-1), base_(nullptr), length_(0), ctrl_(nullptr), slots_(nullptr),
+        capacity_(0), size_(0), deleted_(0), generation_(0), clean_(true) { }
+    // Two stores may not map the same file
+    MmapStore(const MmapStore& rhs) = delete;
+    MmapStore(MmapStore&& rhs) : MmapStore() {
+      swap(rhs);
+    }
+    MmapStore& operator=(MmapStore rhs) {
+      swap(rhs);
+      return *this;
+    }
+    ~MmapStore() {
+      close();
+    }
+    // MmapStore:
+    MmapStore(const std::string& path, size_t n = 1024) : MmapStore() {
+      open(path, n);
+    }
+
+    // ITERATORS:
+    // Container:
+    iterator begin() {
+      return iterator(ctrl_, slots_);
+    }
+    const_iterator begin() const {
+      return const_iterator(ctrl_, slots_);
+    }
+    iterator end() {
+      return iterator(ctrl_ + capacity_, slots_ + capacity_);
+    }
+    const_iterator end() const {
+      return const_iterator(ctrl_ + capacity_, slots_ + capacity_);
+    }
+    const_iterator cbegin() const {
+      return begin();
+    }
+    const_iterator cend() const {
+      return end();
+    }
+
+    // CAPACITY:
+    // Container:
+    bool empty() const {
+      return size_ == 0;
+    }
+    size_type size() const {
+      return size_;
+    }
+    size_type max_size() const {
+      return std::numeric_limits<size_type>::max() / (sizeof(value_type) + 1);
+    }
+
+    // MODIFIERS:
+    // Container:
+    void swap(MmapStore& rhs) {
+      using std::swap;
+      swap(path_, rhs.path_);
+      swap(fd_, rhs.fd_);
+      swap(base_, rhs.base_);
+      swap(length_, rhs.length_);
+      swap(ctrl_, rhs.ctrl_);
+      swap(slots_, rhs.slots_);
+      swap(capacity_, rhs.capacity_);
+      swap(size_, rhs.size_);
+      swap(deleted_, rhs.deleted_);
+      swap(generation_, rhs.generation_);
+      swap(clean_, rhs.clean_);
+    }
+
+    // STORE INTERFACE:
+    // Common:
+    bool contains(const k_type& k) {
+      return find(k) != capacity_;
+    }
+    v_type get(const k_type& k) {
+      const auto idx = find(k);
+      return idx == capacity_ ? V() : slots_[idx].second;
+    }
+    void put(const value_type& v) {
+      if (!is_open()) {
+        return;
+      }
+      const auto idx = find(v.first);
+      if (idx != capacity_) {
+        modify();
+        new (&slots_[idx]) value_type(v);
+        return;
+      }
+      if ((size_ + deleted_ + 1) * 8 > capacity_ * 7) {
+        // Reclaim tombstones in place unless we're genuinely out of room
+        rehash((size_ + 1) * 16 > capacity_ * 7 ? 2 * capacity_ : capacity_);
+        if (size_ + deleted_ + 1 >= capacity_) {
+          // The table couldn't be rebuilt, and must keep an empty slot
+          return;
+        }
+      }
+      modify();
+      insert(hash(v.first), v);
+    }
+    void erase(const k_type& k) {
+      const auto idx = find(k);
+      if (idx == capacity_) {
+        return;
+      }
+      modify();
+      --size_;
+      // A slot followed by an empty one never caused a probe to continue
+      // past it, so it can be reopened without a tombstone
+      if (ctrl_[(idx + 1) & (capacity_ - 1)] == EMPTY) {
+        ctrl_[idx] = EMPTY;
+      } else {
+        ctrl_[idx] = DELETED;
+        ++deleted_;
+      }
+    }
+    void clear() {
+      if (!is_open()) {
+        return;
+      }
+      modify();
+      std::memset(ctrl_, EMPTY, capacity_);
+      size_ = 0;
+      deleted_ = 0;
+    }
+    // MmapStore:
+    // Maps the table in path, creating one with room for n entries if the
+    // file is empty or doesn't exist. A file which was written with other
+    // key or value sizes, or has no valid header, is left closed.
+    void open(const std::string& path, size_t n = 1024) {
+      close();
+      struct stat st;
+      if (::stat(path.c_str(), &st) == 0 && st.st_size > 0) {
+        attach(path, st.st_size);
+      } else {
+        size_t c = MIN_CAPACITY;
+        while (n * 8 > c * 7) {
+          c *= 2;
+        }
+        create(path, c);
+      }
+    }
+    bool is_open() const {
+      return base_ != nullptr;
+    }
+    // Writes the table through to the file and records it as consistent
+    void checkpoint() {
+      if (!is_open()) {
+        return;
+      }
+      msync(base_, length_, MS_SYNC);
+      header(true);
+    }
+    // Checkpoints and unmaps the table
+    void close() {
+      if (!is_open()) {
+        return;
+      }
+      checkpoint();
+      unmap();
+    }
+    const std::string& path() const {
+      return path_;
+    }
+
+    // COMPARISON:
+    // Container:
+    friend bool operator==(const MmapStore& lhs, const MmapStore& rhs) {
+      if (lhs.size_ != rhs.size_) {
+        return false;
+      }
+      for (const auto& v : lhs) {
+        const auto idx = rhs.find(v.first);
+        if (idx == rhs.capacity_ || !(rhs.slots_[idx].second == v.second)) {
+          return false;
+        }
+      }
+      return true;
+    }
+    friend bool operator!=(const MmapStore& lhs, const MmapStore& rhs) {
+      return !(lhs == rhs);
+    }
+
+    // SPECIALIZED ALGORITHMS:
+    // Container:
+    friend void swap(MmapStore& lhs, MmapStore& rhs) {
+      lhs.swap(rhs);
+    }
+
+  private:
+    std::string path_;
+    int fd_;
+    char* base_;
+    size_t length_;
+    // capacity_ control bytes followed by a sentinel, then the slots, both
+    // within the mapping
+    uint8_t* ctrl_;
+    value_type* slots_;
+    size_t capacity_;
+    size_t size_;
+    size_t deleted_;
+    uint64_t generation_;
+    // Whether the newest header still describes the table
+    bool clean_;
+
+    static size_t hash(const K& k) {
+      // std::hash is the identity for integers; mix so that both the slot
+      // index (high bits) and the control byte (low bits) are well spread.
+      uint64_t h = H()(k);
+      h ^= h >> 33;
+      h *= 0xff51afd7ed558ccdull;
+      h ^= h >> 33;
+      return h;
+    }
+
+    // The layout of a file holding c slots
+    static size_t slots_offset(size_t c) {
+      const size_t align = alignof(value_type) > 64 ? alignof(value_type) : 64;
+      return (PAGE + c + 1 + align - 1) / align * align;
+    }
+    static size_t file_length(size_t c) {
+      return slots_offset(c) + c * sizeof(value_type);
+    }
+
+    // FNV-1a over every field but the checksum
+    static uint64_t checksum(const Header& h) {
+      const auto p = reinterpret_cast<const unsigned char*>(&h);
+      uint64_t res = 0xcbf29ce484222325ull;
+      for (size_t i = 0; i < offsetof(Header, checksum); ++i) {
+        res = (res ^ p[i]) * 0x100000001b3ull;
+      }
+      return res;
+    }
+    bool valid(const Header& h) const {
+      return h.magic == MAGIC && h.version == VERSION && h.ksize == sizeof(K) &&
+          h.vsize == sizeof(V) && h.checksum == checksum(h);
+    }
+    // Header copies alternate between the two halves of the first page
+    char* header_slot(uint64_t generation) const {
+      return base_ + (generation % 2) * (PAGE / 2);
+    }
+    // Writes a header for the table in its current state as the next
+    // generation, over the older of the two copies
+    void header(bool clean) {
+      Header h;
+      std::memset(&h, 0, sizeof(h));
+      h.magic = MAGIC;
+      h.version = VERSION;
+      h.clean = clean;
+      h.ksize = sizeof(K);
+      h.vsize = sizeof(V);
+      h.capacity = capacity_;
+      h.size = size_;
+      h.deleted = deleted_;
+      h.generation = ++generation_;
+      h.checksum = checksum(h);
+      std::memcpy(header_slot(generation_), &h, sizeof(h));
+      msync(base_, PAGE, MS_SYNC);
+      clean_ = clean;
+    }
+    // Called before each change to the table, so that a crash before the
+    // next checkpoint is seen on open
+    void modify() {
+      if (clean_) {
+        header(false);
+      }
+    }
+
+    // Returns the slot index holding k, or capacity_ if there is none
+    size_t find(const K& k) const {
+      if (capacity_ == 0) {
+        return capacity_;
+      }
+      const auto h = hash(k);
+      const auto tag = (uint8_t)(FULL | (h & 0x7f));
+      const auto mask = capacity_ - 1;
+      for (size_t idx = (h >> 7) & mask; ; idx = (idx + 1) & mask) {
+        if (ctrl_[idx] == tag && slots_[idx].first == k) {
+          return idx;
+        }
+        if (ctrl_[idx] == EMPTY) {
+          return capacity_;
+        }
+      }
+    }
+    // Places a key known not to be present in the first open slot on its
+    // probe sequence. The load factor guarantees that one exists.
+    void insert(size_t h, const value_type& v) {
+      const auto mask = capacity_ - 1;
+      for (size_t idx = (h >> 7) & mask; ; idx = (idx + 1) & mask) {
+        if (ctrl_[idx] < FULL) {
+          deleted_ -= ctrl_[idx] == DELETED;
+          new (&slots_[idx]) value_type(v);
+          ctrl_[idx] = (uint8_t)(FULL | (h & 0x7f));
+          ++size_;
+          return;
+        }
+      }
+    }
+
+    bool map(int fd, size_t length) {
+      const auto base = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if (base == MAP_FAILED) {
+        return false;
+      }
+      fd_ = fd;
+      base_ = static_cast<char*>(base);
+      length_ = length;
+      return true;
+    }
+    void layout(size_t c) {
+      ctrl_ = reinterpret_cast<uint8_t*>(base_ + PAGE);
+      slots_ = reinterpret_cast<value_type*>(base_ + slots_offset(c));
+      capacity_ = c;
+    }
+    // Unmaps the table without checkpointing it
+    void unmap() {
+      munmap(base_, length_);
+      ::close(fd_);
+      path_.clear();
+      fd_ = -1;
+      base_ = nullptr;
+      length_ = 0;
+      ctrl_ = nullptr;
+      slots_ = nullptr;
+      capacity_ = 0;
+      size_ = 0;
+      deleted_ = 0;
+      generation_ = 0;
+      clean_ = true;
+    }
+
+    // Truncates path to an empty table of c slots
+    bool create(const std::string& path, size_t c) {
+      const auto fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+      if (fd < 0) {
+        return false;
+      }
+      if (ftruncate(fd, file_length(c)) != 0 || !map(fd, file_length(c))) {
+        ::close(fd);
+        return false;
+      }
+      path_ = path;
+      layout(c);
+      ctrl_[c] = SENTINEL;
+      // Fill both header copies
+      checkpoint();
+      header(true);
+      return true;
+    }
+    bool attach(const std::string& path, size_t length) {
+      const auto fd = ::open(path.c_str(), O_RDWR);
+      if (fd < 0) {
+        return false;
+      }
+      if (length < PAGE || !map(fd, length)) {
+        ::close(fd);
+        return false;
+      }
+
+      Header a, b;
+      std::memcpy(&a, base_, sizeof(a));
+      std::memcpy(&b, base_ + PAGE / 2, sizeof(b));
+      const Header* h = nullptr;
+      if (valid(a) && (!valid(b) || a.generation > b.generation)) {
+        h = &a;
+      } else if (valid(b)) {
+        h = &b;
+      }
+      // Both copies are valid after every complete header write, so one
+      // which isn't means the newest was torn and the other may be stale
+      const auto torn = !valid(a) || !valid(b);
+      if (h == nullptr || h->capacity < MIN_CAPACITY || (h->capacity & (h->capacity - 1)) != 0 ||
+          file_length(h->capacity) > length) {
+        unmap();
+        return false;
+      }
+
+      path_ = path;
+      layout(h->capacity);
+      generation_ = h->generation;
+      clean_ = h->clean && !torn;
+      size_ = h->size;
+      deleted_ = h->deleted;
+      if (!clean_) {
+        // Changes after the last checkpoint may have reached some pages and
+        // not others. A full slot whose key doesn't hash to its control byte
+        // was never written, and is dropped as if erased, which keeps the
+        // probe sequences through it intact. The control bytes are then the
+        // only record of the size.
+        size_ = 0;
+        deleted_ = 0;
+        for (size_t i = 0; i < capacity_; ++i) {
+          if (ctrl_[i] >= FULL && ctrl_[i] != (uint8_t)(FULL | (hash(slots_[i].first) & 0x7f))) {
+            ctrl_[i] = DELETED;
+          }
+          size_ += ctrl_[i] >= FULL;
+          deleted_ += ctrl_[i] == DELETED;
+        }
+        ctrl_[capacity_] = SENTINEL;
+      }
+      return true;
+    }
+
+    // Rebuilds the table with c slots in a new file, which then atomically
+    // replaces the old one. The table is left as it was if that fails.
+    void rehash(size_t c) {
+      const auto tmp = path_ + ".tmp";
+      MmapStore s;
+      if (!s.create(tmp, c)) {
+        std::remove(tmp.c_str());
+        return;
+      }
+      for (const auto& v : *this) {
+        s.insert(hash(v.first), v);
+      }
+      s.checkpoint();
+      if (std::rename(tmp.c_str(), path_.c_str()) != 0) {
+        s.unmap();
+        std::remove(tmp.c_str());
+        return;
+      }
+      s.path_ = path_;
+      unmap();
+      swap(s);
+    }
+};
+
+} // namespace binder
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef BINDER_INCLUDE_MULTI_H
+#define BINDER_INCLUDE_MULTI_H
+
+namespace binder {
+
+// Batched forms of the store interface. A store may provide any of these as
+// member functions (taking the same arguments minus the store); the free
+// functions below dispatch to those members where they exist, and otherwise
+// fall back on one single-key call per element. Key and value ranges are
+// forward ranges, and results are written to out in key order.
+
+template <typename S, typename KItr, typename OItr>
+auto multi_contains(S& s, KItr begin, KItr end, OItr out, int)
+    -> decltype(s.multi_contains(begin, end, out), void()) {
+  s.multi_contains(begin, end, out);
+}
+template <typename S, typename KItr, typename OItr>
+void multi_contains(S& s, KItr begin, KItr end, OItr out, long) {
+  for (; begin != end; ++begin) {
+    *out++ = s.contains(*begin);
+  }
+}
+template <typename S, typename KItr, typename OItr>
+void multi_contains(S& s, KItr begin, KItr end, OItr out) {
+  multi_contains(s, begin, end, out, 0);
+}
+
+template <typename S, typename KItr, typename OItr>
+auto multi_get(S& s, KItr begin, KItr end, OItr out, int)
+    -> decltype(s.multi_get(begin, end, out), void()) {
+  s.multi_get(begin, end, out);
+}
+template <typename S, typename KItr, typename OItr>
+void multi_get(S& s, KItr begin, KItr end, OItr out, long) {
+  for (; begin != end; ++begin) {
+    *out++ = s.get(*begin);
+  }
+}
+template <typename S, typename KItr, typename OItr>
+void multi_get(S& s, KItr begin, KItr end, OItr out) {
+  multi_get(s, begin, end, out, 0);
+}
+
+template <typename S, typename VItr>
+auto multi_put(S& s, VItr begin, VItr end, int)
+    -> decltype(s.multi_put(begin, end), void()) {
+  s.multi_put(begin, end);
+}
+template <typename S, typename VItr>
+void multi_put(S& s, VItr begin, VItr end, long) {
+  for (; begin != end; ++begin) {
+    s.put(*begin);
+  }
+}
+template <typename S, typename VItr>
+void multi_put(S& s, VItr begin, VItr end) {
+  multi_put(s, begin, end, 0);
+}
+
+template <typename S, typename KItr>
+auto multi_erase(S& s, KItr begin, KItr end, int)
+    -> decltype(s.multi_erase(begin, end), void()) {
+  s.multi_erase(begin, end);
+}
+template <typename S, typename KItr>
+void multi_erase(S& s, KItr begin, KItr end, long) {
+  for (; begin != end; ++begin) {
+    s.erase(*begin);
+  }
+}
+template <typename S, typename KItr>
+void multi_erase(S& s, KItr begin, KItr end) {
+  multi_erase(s, begin, end, 0);
+}
+
+} // namespace binder
+
+#endif
@@ -0,0 +1,287 @@
+#ifndef BINDER_INCLUDE_NEAR_H
+#define BINDER_INCLUDE_NEAR_H
+
+#include <hiredis/hiredis.h>
+#include <poll.h>
+#include <cstring>
+#include <string>
+#include <utility>
+#include "include/evict.h"
+#include "include/redis.h"
+#include "include/store.h"
+
+namespace binder {
+
+template <typename K, typename V, typename IO = Stream<K,V>, typename S = UnorderedStore<K,V>>
+class NearCache {
+  public:
+    // TYPES:
+    // Container:
+    typedef typename RedisStore<K,V,IO>::value_type value_type;
+    typedef typename RedisStore<K,V,IO>::reference reference;
+    typedef typename RedisStore<K,V,IO>::const_reference const_reference;
+    typedef typename RedisStore<K,V,IO>::iterator iterator;
+    typedef typename RedisStore<K,V,IO>::const_iterator const_iterator;
+    typedef typename RedisStore<K,V,IO>::difference_type difference_type;
+    typedef typename RedisStore<K,V,IO>::size_type size_type;
+    // Other:
+    typedef typename RedisStore<K,V,IO>::k_type k_type;
+    typedef typename RedisStore<K,V,IO>::v_type v_type;
+
+    // CONSTRUCT/COPY/DESTROY:
+    // Container:
+    NearCache() : port_(0), capacity_(1024), sub_(NULL) { }
+    NearCache(const NearCache& rhs) : NearCache() {
+      capacity_ = rhs.capacity_;
+      if (rhs.is_connected()) {
+        connect(rhs.host_, rhs.port_);
+      }
+    }
+    NearCache(NearCache&& rhs) : NearCache() {
+      swap(rhs);
+    }
+    NearCache& operator=(NearCache rhs) {
+      swap(rhs);
+      return *this;
+    }
+    ~NearCache() {
+      disconnect();
+    }
+    // NearCache:
+    NearCache(const std::string& host, unsigned int port, size_t c = 1024) : NearCache() {
+      capacity_ = c;
+      connect(host, port);
+    }
+
+    // ITERATORS:
+    // Container:
+    iterator begin() {
+      return rs_.begin();
+    }
+    const_iterator begin() const {
+      return rs_.begin();
+    }
+    iterator end() {
+      return rs_.end();
+    }
+    const_iterator end() const {
+      return rs_.end();
+    }
+    const_iterator cbegin() const {
+      return rs_.cbegin();
+    }
+    const_iterator cend() const {
+      return rs_.cend();
+    }
+
+    // CAPACITY:
+    // Container:
+    bool empty() const {
+      return rs_.empty();
+    }
+    size_type size() const {
+      return rs_.size();
+    }
+    size_type max_size() const {
+      return rs_.max_size();
+    }
+
+    // MODIFIERS:
+    // Container:
+    void swap(NearCache& rhs) {
+      using std::swap;
+      swap(host_, rhs.host_);
+      swap(port_, rhs.port_);
+      swap(capacity_, rhs.capacity_);
+      swap(rs_, rhs.rs_);
+      swap(sub_, rhs.sub_);
+      swap(s_, rhs.s_);
+      swap(e_, rhs.e_);
+    }
+
+    // STORE INTERFACE:
+    // Common:
+    bool contains(const k_type& k) {
+      sync();
+      return s_.contains(k) || rs_.contains(k);
+    }
+    v_type get(const k_type& k) {
+      sync();
+      if (s_.contains(k)) {
+        e_.touch(k);
+        return s_.get(k);
+      }
+      if (!rs_.is_connected()) {
+        return v_type();
+      }
+
+      // Reading a key is what registers it for tracking, so only values
+      // which were read (and which exist) are kept
+      codec::kwrite(kbuf_, k);
+      auto rep = (redisReply*)redisCommand(rs_.rc_, "GET %b", kbuf_.data(), kbuf_.length());
+      const auto v = codec::vread(rep);
+      if (sub_ != NULL && rep != nullptr && rep->type == REDIS_REPLY_STRING) {
+        s_.put(std::make_pair(k, v));
+        e_.touch(k);
+        resize(capacity_);
+      }
+      freeReplyObject(rep);
+      return v;
+    }
+    void put(const value_type& v) {
+      // A write also ends tracking for the key, so the local copy must go
+      rs_.put(v);
+      drop(v.first);
+    }
+    void erase(const k_type& k) {
+      rs_.erase(k);
+      drop(k);
+    }
+    void clear() {
+      rs_.clear();
+      resize(0);
+    }
+    // NearCache:
+    void connect(const std::string& host, unsigned int port) {
+      disconnect();
+      host_ = host;
+      port_ = port;
+      rs_.connect(host, port);
+      if (!rs_.is_connected()) {
+        return;
+      }
+
+      // Invalidations are redirected to a second connection, so that they
+      // can be read without interleaving with replies on the first
+      sub_ = redisConnectWithTimeout(host.c_str(), port, {1,500000});
+      if (sub_ == NULL || sub_->err) {
+        untrack();
+        return;
+      }
+      auto rep = (redisReply*)redisCommand(sub_, "CLIENT ID");
+      const auto id = rep != nullptr && rep->type == REDIS_REPLY_INTEGER ? rep->integer : -1;
+      freeReplyObject(rep);
+      rep = (redisReply*)redisCommand(sub_, "SUBSCRIBE __redis__:invalidate");
+      const auto subscribed = rep != nullptr && rep->type == REDIS_REPLY_ARRAY;
+      freeReplyObject(rep);
+      rep = subscribed && id >= 0 ? (redisReply*)redisCommand(rs_.rc_,
+          "CLIENT TRACKING on REDIRECT %lld NOLOOP", id) : nullptr;
+      const auto tracking = rep != nullptr && rep->type == REDIS_REPLY_STATUS;
+      freeReplyObject(rep);
+      if (!tracking) {
+        untrack();
+      }
+    }
+    bool is_connected() const {
+      return rs_.is_connected();
+    }
+    // False if the server could not be asked for invalidations, in which case
+    // every request is passed through to it
+    bool is_tracking() const {
+      return sub_ != NULL;
+    }
+    void disconnect() {
+      untrack();
+      rs_.disconnect();
+    }
+    void capacity(size_t c) {
+      capacity_ = c;
+      resize(capacity_);
+    }
+    const S& near_store() const {
+      return s_;
+    }
+
+    // COMPARISON:
+    // Container:
+    friend bool operator==(const NearCache& lhs, const NearCache& rhs) {
+      return lhs.rs_ == rhs.rs_;
+    }
+    friend bool operator!=(const NearCache& lhs, const NearCache& rhs) {
+      return !(lhs == rhs);
+    }
+
+    // SPECIALIZED ALGORITHMS:
+    // Container:
+    friend void swap(NearCache& lhs, NearCache& rhs) {
+      lhs.swap(rhs);
+    }
+
+  private:
+    typedef RedisCodec<K,V,IO> codec;
+
+    std::string host_;
+    unsigned int port_;
+    size_t capacity_;
+    RedisStore<K,V,IO> rs_;
+    redisContext* sub_;
+    S s_;
+    Lru<S> e_;
+    std::string kbuf_;
+
+    // Applies every invalidation which has already arrived, without blocking
+    void sync() {
+      while (sub_ != NULL) {
+        redisReply* rep = nullptr;
+        if (redisGetReplyFromReader(sub_, (void**)&rep) != REDIS_OK) {
+          untrack();
+          return;
+        }
+        if (rep == nullptr) {
+          pollfd fd = {sub_->fd, POLLIN, 0};
+          if (poll(&fd, 1, 0) <= 0) {
+            return;
+          }
+          if (redisBufferRead(sub_) != REDIS_OK) {
+            untrack();
+          }
+          continue;
+        }
+        invalidate(rep);
+        freeReplyObject(rep);
+      }
+    }
+    // Messages are [message, channel, keys], where keys is null if the
+    // database was flushed
+    void invalidate(const redisReply* rep) {
+      if (rep->type != REDIS_REPLY_ARRAY || rep->elements != 3) {
+        return;
+      }
+      const auto kind = rep->element[0];
+      if (kind->type != REDIS_REPLY_STRING || strcmp(kind->str, "message") != 0) {
+        return;
+      }
+      const auto keys = rep->element[2];
+      if (keys->type != REDIS_REPLY_ARRAY) {
+        resize(0);
+        return;
+      }
+      for (size_t i = 0; i < keys->elements; ++i) {
+        drop(codec::kread(keys->element[i]->str, keys->element[i]->len));
+      }
+    }
+    // Nothing can be cached without invalidations
+    void untrack() {
+      if (sub_ != NULL) {
+        redisFree(sub_);
+        sub_ = NULL;
+      }
+      resize(0);
+    }
+
+    void drop(const k_type& k) {
+      if (s_.contains(k)) {
+        e_.erase(k);
+        s_.erase(k);
+      }
+    }
+    void resize(size_t s) {
+      while (s_.size() > s) {
+        drop(e_.evict());
+      }
+    }
+};
+
+} // namespace binder
+
+#endif
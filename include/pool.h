@@ -0,0 +1,143 @@
+#ifndef BINDER_INCLUDE_POOL_H
+#define BINDER_INCLUDE_POOL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "include/redis.h"
+
+namespace binder {
+
+template <typename K, typename V, typename IO = Stream<K,V>>
+class RedisPool {
+  private:
+    struct Slot {
+      std::atomic<bool> busy;
+      std::chrono::steady_clock::time_point used;
+      RedisStore<K,V,IO> rs;
+    };
+
+  public:
+    class Lease {
+      friend class RedisPool;
+
+      // CONSTRUCT/COPY/DESTROY:
+      private:
+        Lease(RedisPool* rp, Slot* slot) : rp_(rp), slot_(slot) { }
+      public:
+        Lease(const Lease& rhs) = delete;
+        Lease(Lease&& rhs) : rp_(rhs.rp_), slot_(rhs.slot_) {
+          rhs.slot_ = nullptr;
+        }
+        Lease& operator=(const Lease& rhs) = delete;
+        Lease& operator=(Lease&& rhs) = delete;
+        ~Lease() {
+          if (slot_ != nullptr) {
+            rp_->release(slot_);
+          }
+        }
+
+        // ABILITIES:
+        RedisStore<K,V,IO>& operator*() {
+          return slot_->rs;
+        }
+        RedisStore<K,V,IO>* operator->() {
+          return &slot_->rs;
+        }
+
+      private:
+        RedisPool* rp_;
+        Slot* slot_;
+    };
+
+    // CONSTRUCT/COPY/DESTROY:
+    RedisPool(const std::string& host, unsigned int port, 
+        size_t size = std::thread::hardware_concurrency(), 
+        std::chrono::milliseconds check = std::chrono::seconds(30)) : 
+        host_(host), port_(port), size_(size > 0 ? size : 1), check_(check), 
+        slots_(new Slot[size_]), waiters_(0), reconnects_(0) {
+      for (size_t i = 0; i < size_; ++i) {
+        slots_[i].busy = false;
+        slots_[i].used = std::chrono::steady_clock::now();
+        slots_[i].rs.connect(host_, port_);
+      }
+    }
+    RedisPool(const RedisPool& rhs) = delete;
+    RedisPool& operator=(const RedisPool& rhs) = delete;
+    ~RedisPool() = default;
+
+    // POOL INTERFACE:
+    // Blocks until a connection is available. A thread is handed the same
+    // connection it last used whenever possible.
+    Lease lease() {
+      static thread_local size_t hint = std::hash<std::thread::id>()(std::this_thread::get_id());
+      auto slot = try_acquire(hint);
+      if (slot == nullptr) {
+        std::unique_lock<std::mutex> lock(m_);
+        ++waiters_;
+        cv_.wait(lock, [this, &slot]{
+          return (slot = try_acquire(hint)) != nullptr;
+        });
+        --waiters_;
+      }
+      check(*slot);
+      return Lease(this, slot);
+    }
+    size_t size() const {
+      return size_;
+    }
+    size_t reconnects() const {
+      return reconnects_;
+    }
+
+  private:
+    std::string host_;
+    unsigned int port_;
+    size_t size_;
+    std::chrono::milliseconds check_;
+    std::unique_ptr<Slot[]> slots_;
+
+    std::mutex m_;
+    std::condition_variable cv_;
+    size_t waiters_;
+    std::atomic<size_t> reconnects_;
+
+    Slot* try_acquire(size_t& hint) {
+      for (size_t i = 0; i < size_; ++i) {
+        const auto idx = (hint + i) % size_;
+        if (!slots_[idx].busy.load(std::memory_order_relaxed) && 
+            !slots_[idx].busy.exchange(true, std::memory_order_acquire)) {
+          hint = idx;
+          return &slots_[idx];
+        }
+      }
+      return nullptr;
+    }
+    void release(Slot* slot) {
+      slot->used = std::chrono::steady_clock::now();
+      slot->busy.store(false, std::memory_order_release);
+      std::lock_guard<std::mutex> lock(m_);
+      if (waiters_ > 0) {
+        cv_.notify_one();
+      }
+    }
+    // Connections which have errored are replaced, and those which have sat
+    // idle for longer than check_ are pinged first
+    void check(Slot& slot) {
+      if (slot.rs.is_connected() && 
+          (std::chrono::steady_clock::now() - slot.used < check_ || slot.rs.ping())) {
+        return;
+      }
+      slot.rs.connect(host_, port_);
+      ++reconnects_;
+    }
+};
+
+} // namespace binder
+
+#endif
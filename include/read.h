@@ -1,10 +1,104 @@
 #ifndef BINDER_INCLUDE_READ_H
 #define BINDER_INCLUDE_READ_H
 
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
+#include "include/multi.h"
 
 namespace binder {
 
+// Stores which can tell a missing key from a present one in a single call may
+// provide lookup(k, v), which writes the value of k to v and returns whether k
+// was found. Otherwise this takes contains() followed by get().
+template <typename S, typename V>
+auto lookup(S& s, const typename S::k_type& k, V& v, int) -> decltype(s.lookup(k, v)) {
+  return s.lookup(k, v);
+}
+template <typename S, typename V>
+bool lookup(S& s, const typename S::k_type& k, V& v, long) {
+  if (!s.contains(k)) {
+    return false;
+  }
+  v = s.get(k);
+  return true;
+}
+template <typename S, typename V>
+bool lookup(S& s, const typename S::k_type& k, V& v) {
+  return lookup(s, k, v, 0);
+}
+
+// Stores which can do the same for many keys in a single call may provide
+// multi_lookup(begin, end, out), which writes the key and value of each key
+// found to out, in order. Otherwise this takes multi_contains() followed by
+// multi_get() of the keys found.
+template <typename S, typename KItr, typename OItr>
+auto multi_lookup(S& s, KItr begin, KItr end, OItr out, int)
+    -> decltype(s.multi_lookup(begin, end, out), void()) {
+  s.multi_lookup(begin, end, out);
+}
+template <typename S, typename KItr, typename OItr>
+void multi_lookup(S& s, KItr begin, KItr end, OItr out, long) {
+  std::vector<char> cs;
+  binder::multi_contains(s, begin, end, std::back_inserter(cs));
+  std::vector<typename std::remove_const<typename S::k_type>::type> ks;
+  for (size_t i = 0; begin != end; ++begin, ++i) {
+    if (cs[i]) {
+      ks.push_back(*begin);
+    }
+  }
+  std::vector<typename std::remove_const<typename S::v_type>::type> vs;
+  vs.reserve(ks.size());
+  binder::multi_get(s, ks.begin(), ks.end(), std::back_inserter(vs));
+  for (size_t i = 0, ie = ks.size(); i < ie; ++i) {
+    *out++ = std::make_pair(ks[i], vs[i]);
+  }
+}
+template <typename S, typename KItr, typename OItr>
+void multi_lookup(S& s, KItr begin, KItr end, OItr out) {
+  multi_lookup(s, begin, end, out, 0);
+}
+
+// Matches the results of a batched fetch, from vb to ve, to the keys fetched,
+// from kb to ke, invoking f(i, v) with the index of each key found and its
+// value. Results may be missing keys and needn't be in key order, but usually
+// are, so each search resumes after the last match and wraps around at most
+// once.
+template <typename VItr, typename KItr, typename F>
+void match(VItr vb, VItr ve, KItr kb, KItr ke, F f) {
+  auto v = vb;
+  for (size_t i = 0; kb != ke; ++kb, ++i) {
+    const auto eq = [&](const typename std::iterator_traits<VItr>::value_type& x) { return x.first == *kb; };
+    auto itr = std::find_if(v, ve, eq);
+    if (itr == ve && (itr = std::find_if(vb, v, eq)) == v) {
+      continue;
+    }
+    f(i, itr->second);
+    v = std::next(itr);
+  }
+}
+
+// Read policies which remember absent keys may provide invalidate(k), which
+// Cache invokes whenever it puts k
+template <typename R, typename K>
+auto invalidate(R& r, const K& k, int) -> decltype(r.invalidate(k), void()) {
+  r.invalidate(k);
+}
+template <typename R, typename K>
+void invalidate(R&, const K&, long) {
+  // Does nothing.
+}
+template <typename R, typename K>
+void invalidate(R& r, const K& k) {
+  invalidate(r, k, 0);
+}
+
 template <typename S>
 class Fetch {
   public:
@@ -12,10 +106,16 @@ class Fetch {
 
     void fetch(S& s, const typename S::k_type& k) {
       vs_.clear();
-      if (s.contains(k)) {
-        vs_.push_back(std::make_pair(k,s.get(k)));
+      typename std::remove_const<typename S::v_type>::type v;
+      if (binder::lookup(s, k, v)) {
+        vs_.push_back(std::make_pair(k, v));
       }
     }
+    template <typename KItr>
+    void fetch(S& s, KItr begin, KItr end) {
+      vs_.clear();
+      binder::multi_lookup(s, begin, end, std::back_inserter(vs_));
+    }
     const_iterator begin() {
       return vs_.begin();
     }
@@ -31,6 +131,117 @@ class Fetch {
     std::vector<typename S::value_type> vs_;
 };
 
+// Remembers keys which R found to be missing from the backing store, so that
+// fetching them again within ttl doesn't go back to it. At most capacity keys
+// are remembered, the oldest being forgotten first, and a key is forgotten as
+// soon as it is put.
+template <typename S, typename R = Fetch<S>,
+          typename H = std::hash<typename std::remove_const<typename S::k_type>::type>>
+class Negative {
+  private:
+    typedef typename std::remove_const<typename S::k_type>::type key_type;
+    typedef std::chrono::steady_clock clock;
+
+  public:
+    typedef typename R::const_iterator const_iterator;
+
+    explicit Negative(size_t capacity = 1024,
+                      clock::duration ttl = std::chrono::seconds(1))
+        : capacity_(capacity), ttl_(ttl), skip_(false) { }
+
+    void fetch(S& s, const typename S::k_type& k) {
+      const auto now = clock::now();
+      skip_ = absent(k, now);
+      if (!skip_) {
+        r_.fetch(s, k);
+        if (std::none_of(r_.begin(), r_.end(), [&](const auto& v) { return v.first == k; })) {
+          remember(k, now);
+        }
+      }
+    }
+    template <typename KItr>
+    void fetch(S& s, KItr begin, KItr end) {
+      const auto now = clock::now();
+      std::vector<key_type> ks;
+      for (; begin != end; ++begin) {
+        if (!absent(*begin, now)) {
+          ks.push_back(*begin);
+        }
+      }
+      skip_ = false;
+      r_.fetch(s, ks.begin(), ks.end());
+      std::unordered_set<key_type, H> found;
+      for (auto v = r_.begin(), ve = r_.end(); v != ve; ++v) {
+        found.insert(v->first);
+      }
+      for (const auto& k : ks) {
+        if (found.count(k) == 0) {
+          remember(k, now);
+        }
+      }
+    }
+    const_iterator begin() {
+      return skip_ ? r_.end() : r_.begin();
+    }
+    const_iterator end() {
+      return r_.end();
+    }
+    void invalidate(const typename S::k_type& k) {
+      misses_.erase(k);
+    }
+    // The number of keys currently remembered as missing
+    size_t size() const {
+      return misses_.size();
+    }
+    friend void swap(Negative& lhs, Negative& rhs) {
+      using std::swap;
+      swap(lhs.r_, rhs.r_);
+      swap(lhs.capacity_, rhs.capacity_);
+      swap(lhs.ttl_, rhs.ttl_);
+      swap(lhs.skip_, rhs.skip_);
+      swap(lhs.misses_, rhs.misses_);
+      swap(lhs.order_, rhs.order_);
+    }
+
+  private:
+    R r_;
+    size_t capacity_;
+    clock::duration ttl_;
+    // Whether the last fetch was answered from misses_ alone
+    bool skip_;
+    // The expiry of each missing key, and the keys in the order they were
+    // remembered. Every key has the same ttl, so this is also the order in
+    // which they expire. Invalidated or refreshed keys leave stale entries in
+    // order_, which are told apart by their expiry.
+    std::unordered_map<key_type, clock::time_point, H> misses_;
+    std::deque<std::pair<key_type, clock::time_point>> order_;
+
+    bool absent(const typename S::k_type& k, clock::time_point now) {
+      auto itr = misses_.find(k);
+      if (itr == misses_.end()) {
+        return false;
+      }
+      if (itr->second <= now) {
+        misses_.erase(itr);
+        return false;
+      }
+      return true;
+    }
+    void remember(const typename S::k_type& k, clock::time_point now) {
+      const auto expiry = now + ttl_;
+      misses_[k] = expiry;
+      order_.emplace_back(k, expiry);
+      while (!order_.empty() && (misses_.size() > capacity_ ||
+          order_.size() > 2 * capacity_ || order_.front().second <= now)) {
+        auto itr = misses_.find(order_.front().first);
+        if (itr != misses_.end() && itr->second == order_.front().second) {
+          misses_.erase(itr);
+        }
+        order_.pop_front();
+      }
+    }
+};
+
 } // namespace binder
 
 #endif
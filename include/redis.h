@@ -2,56 +2,66 @@
 #define BINDER_INCLUDE_REDIS_H
 
 #include <hiredis/hiredis.h>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <initializer_list>
 #include <iostream>
 #include <limits>
+#include <memory>
 #include <sstream>
+#include <string>
 #include <type_traits>
-#include "ext/stl/include/buf_stream.h"
+#include <vector>
+#include "include/codec.h"
 
 namespace binder {
 
-template <typename K, typename V>
-struct Stream {
-  void kread(std::istream& is, K& k) {
-    is >> k;
-  }
-  void vread(std::istream& is, V& v) {
-    is >> v;
-  }
-  void kwrite(std::ostream& os, const K& k) {
-    os << k;
-  }
-  void vwrite(std::ostream& os, const V& v) {
-    os << v;
+// Converts keys and values to and from the strings stored by Redis
+template <typename K, typename V, typename IO>
+struct RedisCodec : Codec<K, V, IO> {
+  static V vread(const redisReply* rep) {
+    if (rep == nullptr || rep->type != REDIS_REPLY_STRING) {
+      return V();
+    }
+    return Codec<K, V, IO>::vread(rep->str, rep->len);
   }
 };
 
+template <typename K, typename V, typename IO, typename S>
+class NearCache;
+
 template <typename K, typename V, typename IO = Stream<K,V>>
 class RedisStore {
+  // Shares the connection in order to enable tracking on it
+  template <typename, typename, typename, typename> friend class NearCache;
+
+  private:
+    struct Page;
+
   public:
     template <bool is_const>
     class Iterator {
       friend class RedisStore;
+      template <bool> friend class Iterator;
 
       // TYPES:
-      private:
-        typedef typename RedisStore::reference ref;
-        typedef typename RedisStore::value_type* ptr;
       public:
         typedef typename RedisStore::value_type value_type;
-        typedef typename std::conditional<is_const, const ref, ref>::type reference;
-        typedef typename std::conditional<is_const, const ptr, ptr>::type pointer;
+        typedef typename std::conditional<is_const, const value_type&, value_type&>::type reference;
+        typedef typename std::conditional<is_const, const value_type*, value_type*>::type pointer;
         typedef typename RedisStore::difference_type difference_type;
         typedef typename std::forward_iterator_tag iterator_category;
 
       // CONSTRUCT/COPY/DESTROY:
       private:
-        Iterator(RedisStore* rs) : rs_(rs), scan_(nullptr), val_(nullptr) { }
+        Iterator(RedisStore* rs) : rs_(rs), page_(nullptr), idx_(0) { }
       public:
-        Iterator() : rs_(nullptr), scan_(nullptr), val_(nullptr) { }
-        Iterator(const Iterator& rhs) : rs_(rhs.rs_), scan_(nullptr), val_(nullptr) {
-          scan(rhs.cursor_, rhs.idx_); 
-        }
+        Iterator() : rs_(nullptr), page_(nullptr), idx_(0) { }
+        // Copies share the current page rather than scanning it again
+        Iterator(const Iterator& rhs) = default;
+        template <bool c = is_const, typename = typename std::enable_if<c>::type>
+        Iterator(const Iterator<false>& rhs) : rs_(rhs.rs_), page_(rhs.page_), idx_(rhs.idx_) { }
         Iterator(Iterator&& rhs) : Iterator() {
           swap(rhs);
         }
@@ -59,38 +69,27 @@ class RedisStore {
           swap(rhs);
           return *this;
         }
-        ~Iterator() {
-          if (scan_ != nullptr) {
-            freeReplyObject(scan_);
-          }
-          if (val_ != nullptr) {
-            delete val_;
-          }
-        }
+        ~Iterator() = default;
 
         // ABILITIES:
         reference operator*() {
-          get();
-          return *val_;
+          return page_->vals[idx_];
         }
         pointer operator->() {
-          get();
-          return val_;
+          return &page_->vals[idx_];
         }
         Iterator& operator++() {
-          if (scan_ == nullptr) {
-            scan(0, 0);
-            return *this;
-          } 
-          ++idx_;
-          while (idx_ == (size_t)scan_->element[1]->elements) {
-            const auto ncursor = atoi(scan_->element[0]->str);
-            if (ncursor == 0) {
-              freeReplyObject(scan_);
-              scan_ = nullptr;
-              return *this;
-            } 
-            scan(ncursor, 0);
+          if (page_ == nullptr) {
+            scan("0");
+          } else {
+            ++idx_;
+          }
+          while (page_ != nullptr && idx_ == page_->vals.size()) {
+            if (page_->next == "0") {
+              page_ = nullptr;
+            } else {
+              scan(page_->next);
+            }
           }
           return *this;
         }
@@ -100,8 +99,9 @@ class RedisStore {
           return ret;
         }
         bool operator==(const Iterator& rhs) const {
-          return (scan_ == nullptr && rhs.scan_ == nullptr) ||
-              (cursor_ == rhs.cursor_ && idx_ == rhs.idx_);
+          return (page_ == nullptr && rhs.page_ == nullptr) ||
+              (page_ != nullptr && rhs.page_ != nullptr &&
+               page_->cursor == rhs.page_->cursor && idx_ == rhs.idx_);
         }
         bool operator!=(const Iterator& rhs) const {
           return !(*this == rhs);
@@ -109,45 +109,168 @@ class RedisStore {
 
       private:
         RedisStore* rs_;
-        redisReply* scan_;
-        value_type* val_;
-        unsigned int cursor_;
+        std::shared_ptr<Page> page_;
         size_t idx_;
 
-        void scan(unsigned int cursor, size_t idx) {
-          if (scan_ != nullptr) {
-            freeReplyObject(scan_);
-          }
+        // Reads the page at cursor along with all of its values, at a cost
+        // of two round trips. Keys erased in between are skipped.
+        void scan(std::string cursor) {
+          page_ = nullptr;
+          idx_ = 0;
           if (rs_ == nullptr || !rs_->is_connected()) {
-            scan_ = nullptr;
-          } else {
-            scan_ = (redisReply*)redisCommand(rs_->rc_, "SCAN %i", cursor); 
-            cursor_ = cursor;
-            idx_ = idx >= (size_t)scan_->element[1]->elements ? 0 : idx;
+            return;
           }
-        }
-        void get() {
-          if (val_ != nullptr) {
-            delete val_;
+          auto rep = rs_->command("SCAN", {cursor, "COUNT", std::to_string(rs_->scan_count_)});
+          if (rep == nullptr || rep->type != REDIS_REPLY_ARRAY || rep->elements != 2) {
+            freeReplyObject(rep);
+            return;
           }
-          if (rs_ == nullptr || !rs_->is_connected() || scan_ == nullptr) {
-            val_ = new value_type();
-          } else {
-            auto ptr = scan_->element[1]->element[idx_];
-            stl::buf_stream bs(ptr->str, ptr->str+ptr->len);
-            K k;
-            IO().kread(bs, k);
-            const auto v = rs_->get(ptr->str, (size_t)ptr->len);
-            val_ = new value_type(std::move(k), std::move(v));
+
+          auto page = std::make_shared<Page>();
+          page->cursor = std::move(cursor);
+          page->next.assign(rep->element[0]->str, rep->element[0]->len);
+          const auto keys = rep->element[1];
+          if (keys->elements > 0) {
+            std::vector<std::string> args;
+            args.reserve(keys->elements);
+            for (size_t i = 0; i < keys->elements; ++i) {
+              args.emplace_back(keys->element[i]->str, keys->element[i]->len);
+            }
+            auto vals = rs_->command("MGET", args);
+            page->vals.reserve(args.size());
+            for (size_t i = 0; vals != nullptr && i < vals->elements; ++i) {
+              if (vals->element[i]->type != REDIS_REPLY_STRING) {
+                continue;
+              }
+              page->vals.emplace_back(codec::kread(keys->element[i]->str, keys->element[i]->len),
+                  codec::vread(vals->element[i]));
+            }
+            freeReplyObject(vals);
           }
+          freeReplyObject(rep);
+          page_ = std::move(page);
         }
         void swap(Iterator& rhs) {
           using std::swap;
           swap(rs_, rhs.rs_);
-          swap(scan_, rhs.scan_);
-          swap(cursor_, rhs.cursor_);
+          swap(page_, rhs.page_);
           swap(idx_, rhs.idx_);
-          swap(val_, rhs.val_);
+        }
+    };
+
+    class Pipeline {
+      friend class RedisStore;
+
+      // TYPES:
+      private:
+        typedef typename RedisStore::k_type k_type;
+        typedef typename RedisStore::value_type value_type;
+
+      // CONSTRUCT/COPY/DESTROY:
+      private:
+        Pipeline(RedisStore* rs, size_t batch) : rs_(rs), batch_(batch), errors_(0) { }
+      public:
+        Pipeline(const Pipeline& rhs) = delete;
+        Pipeline(Pipeline&& rhs) : rs_(rhs.rs_), batch_(rhs.batch_), errors_(rhs.errors_),
+            kinds_(std::move(rhs.kinds_)), cps_(std::move(rhs.cps_)), gps_(std::move(rhs.gps_)) {
+          rhs.rs_ = nullptr;
+          rhs.kinds_.clear();
+        }
+        Pipeline& operator=(const Pipeline& rhs) = delete;
+        Pipeline& operator=(Pipeline&& rhs) = delete;
+        ~Pipeline() {
+          flush();
+        }
+
+        // PIPELINE INTERFACE:
+        std::future<bool> contains(const k_type& k) {
+          cps_.emplace_back();
+          auto res = cps_.back().get_future();
+          if (!append(CONTAINS, {"EXISTS", codec::kstr(k)})) {
+            cps_.back().set_value(false);
+            cps_.pop_back();
+          }
+          return res;
+        }
+        std::future<V> get(const k_type& k) {
+          gps_.emplace_back();
+          auto res = gps_.back().get_future();
+          if (!append(GET, {"GET", codec::kstr(k)})) {
+            gps_.back().set_value(V());
+            gps_.pop_back();
+          }
+          return res;
+        }
+        void put(const value_type& v) {
+          append(OTHER, {"SET", codec::kstr(v.first), codec::vstr(v.second)});
+        }
+        void erase(const k_type& k) {
+          append(OTHER, {"DEL", codec::kstr(k)});
+        }
+        void flush() {
+          for (auto kind : kinds_) {
+            redisReply* rep = nullptr;
+            if (redisGetReply(rs_->rc_, (void**)&rep) != REDIS_OK || rep == nullptr) {
+              ++errors_;
+            } else if (rep->type == REDIS_REPLY_ERROR) {
+              ++errors_;
+            }
+            switch (kind) {
+              case CONTAINS:
+                cps_.front().set_value(rep != nullptr && rep->integer == 1);
+                cps_.pop_front();
+                break;
+              case GET:
+                gps_.front().set_value(codec::vread(rep));
+                gps_.pop_front();
+                break;
+              default:
+                break;
+            }
+            freeReplyObject(rep);
+          }
+          kinds_.clear();
+        }
+        size_t errors() const {
+          return errors_;
+        }
+
+      private:
+        enum Kind : char {
+          CONTAINS,
+          GET,
+          OTHER
+        };
+
+        RedisStore* rs_;
+        size_t batch_;
+        size_t errors_;
+        // The kind of every command awaiting a reply, and the promises for
+        // those which return a result, both in the order they were issued
+        std::vector<Kind> kinds_;
+        std::deque<std::promise<bool>> cps_;
+        std::deque<std::promise<V>> gps_;
+
+        bool append(Kind kind, std::initializer_list<std::string> args) {
+          if (rs_ == nullptr || !rs_->is_connected()) {
+            return false;
+          }
+          const char* argv[3];
+          size_t lens[3];
+          size_t argc = 0;
+          for (const auto& a : args) {
+            argv[argc] = a.c_str();
+            lens[argc++] = a.length();
+          }
+          if (redisAppendCommandArgv(rs_->rc_, argc, argv, lens) != REDIS_OK) {
+            ++errors_;
+            return false;
+          }
+          kinds_.push_back(kind);
+          if (kinds_.size() >= batch_) {
+            flush();
+          }
+          return true;
         }
     };
 
@@ -166,24 +289,25 @@ class RedisStore {
 
     // CONSTRUCT/COPY/DESTROY:
     // Container:
-    RedisStore() : rc_(NULL) { }
-    RedisStore(const RedisStore& rhs) : rc_(NULL), host_(rhs.host_), port_(rhs.port_) {
+    RedisStore() : rc_(NULL), scan_count_(1024) { }
+    RedisStore(const RedisStore& rhs) : host_(rhs.host_), port_(rhs.port_), rc_(NULL),
+        scan_count_(rhs.scan_count_) {
       if (rhs.is_connected()) {
         connect(host_, port_);
       }
     }
     RedisStore(RedisStore&& rhs) : RedisStore() {
-      swap(*this, rhs);
+      swap(rhs);
     }
     RedisStore& operator=(RedisStore rhs) {
-      swap(*this, rhs);
+      swap(rhs);
       return *this;
     }
     ~RedisStore() {
       disconnect();
     }
     // RedisStore:
-    RedisStore(const std::string& host, unsigned int port) {
+    RedisStore(const std::string& host, unsigned int port) : RedisStore() {
       connect(host, port);
     }
 
@@ -199,7 +323,7 @@ class RedisStore {
       return iterator(this);
     }
     const_iterator end() const {
-      return iterator(const_cast<RedisStore*>(this));
+      return const_iterator(const_cast<RedisStore*>(this));
     }
     const_iterator cbegin() const {
       return ++const_iterator(const_cast<RedisStore*>(this));
@@ -235,6 +359,7 @@ class RedisStore {
       swap(host_, rhs.host_);
       swap(port_, rhs.port_);
       swap(rc_, rhs.rc_);
+      swap(scan_count_, rhs.scan_count_);
     }
 
     // STORE INTERFACE:
@@ -244,10 +369,9 @@ class RedisStore {
         return false;
       }
 
-      std::stringstream kss;
-      IO().kwrite(kss, k);
-      auto rep = (redisReply*)redisCommand(rc_, "EXISTS %b", kss.str().c_str(), kss.str().length());
-      const auto res = rep->integer == 1;
+      codec::kwrite(kbuf_, k);
+      auto rep = (redisReply*)redisCommand(rc_, "EXISTS %b", kbuf_.data(), kbuf_.length());
+      const auto res = rep != nullptr && rep->integer == 1;
       freeReplyObject(rep);
 
       return res;
@@ -257,22 +381,34 @@ class RedisStore {
         return v_type();
       }
 
-      std::stringstream kss;
-      IO().kwrite(kss, k);
-      return get(kss.str().c_str(), kss.str().length());
+      codec::kwrite(kbuf_, k);
+      return get(kbuf_.data(), kbuf_.length());
+    }
+    // Reads k into v with a single GET, and returns whether it was found
+    bool lookup(const k_type& k, V& v) {
+      if (!is_connected()) {
+        return false;
+      }
+
+      codec::kwrite(kbuf_, k);
+      auto rep = (redisReply*)redisCommand(rc_, "GET %b", kbuf_.data(), kbuf_.length());
+      const auto res = rep != nullptr && rep->type == REDIS_REPLY_STRING;
+      if (res) {
+        v = codec::vread(rep);
+      }
+      freeReplyObject(rep);
+
+      return res;
     }
     void put(const value_type& v) {
       if (!is_connected()) {
         return;
       }
 
-      std::stringstream kss;
-      IO().kwrite(kss, v.first);
-      std::stringstream vss;
-      IO().vwrite(vss, v.second);
-
+      codec::kwrite(kbuf_, v.first);
+      codec::vwrite(vbuf_, v.second);
       auto rep = (redisReply*)redisCommand(rc_, "SET %b %b",
-          kss.str().c_str(), kss.str().length(), vss.str().c_str(), vss.str().length());
+          kbuf_.data(), kbuf_.length(), vbuf_.data(), vbuf_.length());
       freeReplyObject(rep);
     }
     void erase(const k_type& k) {
@@ -280,9 +416,8 @@ class RedisStore {
         return;
       }
 
-      std::stringstream kss;
-      IO().kwrite(kss, k);
-      auto rep = (redisReply*)redisCommand(rc_, "DEL %b", kss.str().c_str(), kss.str().length());
+      codec::kwrite(kbuf_, k);
+      auto rep = (redisReply*)redisCommand(rc_, "DEL %b", kbuf_.data(), kbuf_.length());
       freeReplyObject(rep);
     }
     void clear() {
@@ -292,11 +427,101 @@ class RedisStore {
       auto rep = (redisReply*)redisCommand(rc_, "FLUSHDB");
       freeReplyObject(rep);
     }
+    // Batched:
+    template <typename KItr, typename OItr>
+    void multi_contains(KItr begin, KItr end, OItr out) {
+      if (!is_connected()) {
+        for (; begin != end; ++begin) {
+          *out++ = false;
+        }
+        return;
+      }
+
+      // EXISTS only reports a count for multiple keys, so pipeline one per key
+      size_t n = 0;
+      for (auto k = begin; k != end; ++k, ++n) {
+        const auto ks = codec::kstr(*k);
+        redisAppendCommand(rc_, "EXISTS %b", ks.c_str(), ks.length());
+      }
+      for (size_t i = 0; i < n; ++i) {
+        redisReply* rep = nullptr;
+        redisGetReply(rc_, (void**)&rep);
+        *out++ = rep != nullptr && rep->integer == 1;
+        freeReplyObject(rep);
+      }
+    }
+    template <typename KItr, typename OItr>
+    void multi_get(KItr begin, KItr end, OItr out) {
+      std::vector<std::string> args;
+      for (auto k = begin; k != end; ++k) {
+        args.push_back(codec::kstr(*k));
+      }
+      if (args.empty()) {
+        return;
+      }
+
+      auto rep = is_connected() ? command("MGET", args) : nullptr;
+      for (size_t i = 0, ie = args.size(); i < ie; ++i) {
+        *out++ = rep != nullptr && i < rep->elements ? codec::vread(rep->element[i]) : V();
+      }
+      freeReplyObject(rep);
+    }
+    // A single MGET, whose nil replies tell missing keys from present ones
+    template <typename KItr, typename OItr>
+    void multi_lookup(KItr begin, KItr end, OItr out) {
+      if (!is_connected() || begin == end) {
+        return;
+      }
+
+      std::vector<std::string> args;
+      for (auto k = begin; k != end; ++k) {
+        args.push_back(codec::kstr(*k));
+      }
+
+      auto rep = command("MGET", args);
+      for (size_t i = 0; begin != end; ++begin, ++i) {
+        if (rep != nullptr && i < rep->elements && rep->element[i]->type == REDIS_REPLY_STRING) {
+          *out++ = std::make_pair(*begin, codec::vread(rep->element[i]));
+        }
+      }
+      freeReplyObject(rep);
+    }
+    template <typename VItr>
+    void multi_put(VItr begin, VItr end) {
+      if (!is_connected() || begin == end) {
+        return;
+      }
+
+      std::vector<std::string> args;
+      for (; begin != end; ++begin) {
+        args.push_back(codec::kstr(begin->first));
+        args.push_back(codec::vstr(begin->second));
+      }
+      freeReplyObject(command("MSET", args));
+    }
+    template <typename KItr>
+    void multi_erase(KItr begin, KItr end) {
+      if (!is_connected() || begin == end) {
+        return;
+      }
+
+      std::vector<std::string> args;
+      for (; begin != end; ++begin) {
+        args.push_back(codec::kstr(*begin));
+      }
+      freeReplyObject(command("DEL", args));
+    }
     // RedisStore:
+    // A store with its own connection to the same server, for another thread
+    RedisStore clone() const {
+      return RedisStore(*this);
+    }
+    Pipeline pipeline(size_t batch = 1024) {
+      return Pipeline(this, batch);
+    }
     void connect(const std::string& host, unsigned int port) {
-      if (is_connected()) {
-        disconnect();
-      }
+      // Also frees a context which failed to connect or has since errored
+      disconnect();
       host_ = host;
       port_ = port;
       rc_ = redisConnectWithTimeout(host.c_str(), port, {1,500000});
@@ -304,6 +529,19 @@ class RedisStore {
     bool is_connected() const {
       return rc_ != NULL && !rc_->err;
     }
+    bool ping() {
+      if (!is_connected()) {
+        return false;
+      }
+      auto rep = (redisReply*)redisCommand(rc_, "PING");
+      const auto res = rep != nullptr && rep->type == REDIS_REPLY_STATUS;
+      freeReplyObject(rep);
+      return res;
+    }
+    // The number of keys requested by each SCAN during iteration
+    void set_scan_count(size_t count) {
+      scan_count_ = count == 0 ? 1 : count;
+    }
     void disconnect() {
       if (rc_ != NULL) {
         redisFree(rc_);
@@ -327,18 +565,40 @@ class RedisStore {
     }
 
   private:
+    typedef RedisCodec<K,V,IO> codec;
+
+    // The decoded contents of a single SCAN reply, shared by the iterators
+    // which have reached it
+    struct Page {
+      std::string cursor;
+      std::string next;
+      std::vector<value_type> vals;
+    };
+
     std::string host_;
     unsigned int port_;
     redisContext* rc_;
+    size_t scan_count_;
+    // Scratch space for encoding keys and values, reused between calls
+    std::string kbuf_;
+    std::string vbuf_;
 
     v_type get(const char* k, size_t len) {
-      V v;
       auto rep = (redisReply*)redisCommand(rc_, "GET %b", k, len);
-      stl::buf_stream bs(rep->str, rep->str+rep->len);
-      IO().vread(bs, v);
+      const auto v = codec::vread(rep);
       freeReplyObject(rep);
       return v;
     }
+
+    redisReply* command(const char* cmd, const std::vector<std::string>& args) {
+      std::vector<const char*> argv(1, cmd);
+      std::vector<size_t> lens(1, strlen(cmd));
+      for (const auto& a : args) {
+        argv.push_back(a.c_str());
+        lens.push_back(a.length());
+      }
+      return (redisReply*)redisCommandArgv(rc_, argv.size(), argv.data(), lens.data());
+    }
 };
 
 } // namespace binder
@@ -0,0 +1,416 @@
+#ifndef BINDER_INCLUDE_RING_H
+#define BINDER_INCLUDE_RING_H
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "include/multi.h"
+#include "include/redis.h"
+
+namespace binder {
+
+// A consistent-hash ring which maps hashes to nodes. Each node is placed at
+// several points (virtual nodes) chosen by hashing its name, so adding or
+// removing a node only moves the keys in the ranges adjacent to its points.
+class HashRing {
+  public:
+    HashRing(size_t vnodes = 160) : vnodes_(vnodes) { }
+
+    // Places node at the points derived from name
+    void add(const std::string& name, size_t node) {
+      for (size_t i = 0; i < vnodes_; ++i) {
+        points_.push_back(std::make_pair(mix(fnv(name + "#" + std::to_string(i))), node));
+      }
+      std::sort(points_.begin(), points_.end());
+    }
+    // Removes node, and renumbers the nodes which follow it
+    void remove(size_t node) {
+      points_.erase(std::remove_if(points_.begin(), points_.end(),
+          [node](const std::pair<uint64_t, size_t>& p) { return p.second == node; }), points_.end());
+      for (auto& p : points_) {
+        if (p.second > node) {
+          --p.second;
+        }
+      }
+    }
+    // The node owning the first point at or after h, which must not be called
+    // on an empty ring
+    size_t find(uint64_t h) const {
+      auto itr = std::lower_bound(points_.begin(), points_.end(),
+          std::make_pair(mix(h), size_t(0)));
+      return itr == points_.end() ? points_.front().second : itr->second;
+    }
+    bool empty() const {
+      return points_.empty();
+    }
+
+  private:
+    size_t vnodes_;
+    std::vector<std::pair<uint64_t, size_t>> points_;
+
+    // Node names are hashed independently of std::hash, so that every client
+    // builds the same ring
+    static uint64_t fnv(const std::string& s) {
+      uint64_t h = 0xcbf29ce484222325ull;
+      for (auto c : s) {
+        h = (h ^ (unsigned char)c) * 0x100000001b3ull;
+      }
+      return h;
+    }
+    static uint64_t mix(uint64_t h) {
+      h ^= h >> 33;
+      h *= 0xff51afd7ed558ccdull;
+      h ^= h >> 33;
+      h *= 0xc4ceb9fe1a85ec53ull;
+      h ^= h >> 33;
+      return h;
+    }
+};
+
+template <typename K, typename V, typename IO = Stream<K,V>, typename H = std::hash<K>>
+class ShardedRedisStore {
+  private:
+    typedef RedisStore<K,V,IO> store_type;
+
+  public:
+    template <bool is_const>
+    class Iterator {
+      friend class ShardedRedisStore;
+      template <bool> friend class Iterator;
+
+      // TYPES:
+      private:
+        typedef typename std::conditional<is_const,
+          typename store_type::const_iterator, typename store_type::iterator>::type itr_type;
+        typedef typename std::conditional<is_const,
+          const ShardedRedisStore*, ShardedRedisStore*>::type srs_type;
+      public:
+        typedef typename ShardedRedisStore::value_type value_type;
+        typedef typename itr_type::reference reference;
+        typedef typename itr_type::pointer pointer;
+        typedef typename ShardedRedisStore::difference_type difference_type;
+        typedef typename std::forward_iterator_tag iterator_category;
+
+      // CONSTRUCT/COPY/DESTROY:
+      private:
+        Iterator(srs_type srs, size_t idx) : srs_(srs), idx_(idx) {
+          if (idx_ < srs_->rs_.size()) {
+            itr_ = srs_->rs_[idx_].begin();
+            skip();
+          }
+        }
+      public:
+        Iterator() : srs_(nullptr), idx_(0) { }
+        Iterator(const Iterator& rhs) = default;
+        template <bool c = is_const, typename = typename std::enable_if<c>::type>
+        Iterator(const Iterator<false>& rhs) : srs_(rhs.srs_), idx_(rhs.idx_), itr_(rhs.itr_) { }
+        Iterator& operator=(const Iterator& rhs) = default;
+
+        // ABILITIES:
+        reference operator*() {
+          return *itr_;
+        }
+        pointer operator->() {
+          return itr_.operator->();
+        }
+        Iterator& operator++() {
+          ++itr_;
+          skip();
+          return *this;
+        }
+        Iterator operator++(int) {
+          auto ret = *this;
+          ++(*this);
+          return ret;
+        }
+        bool operator==(const Iterator& rhs) const {
+          return idx_ == rhs.idx_ && (srs_ == nullptr || idx_ == srs_->rs_.size() || itr_ == rhs.itr_);
+        }
+        bool operator!=(const Iterator& rhs) const {
+          return !(*this == rhs);
+        }
+
+      private:
+        srs_type srs_;
+        size_t idx_;
+        itr_type itr_;
+
+        // Moves on to the next shard with any keys, scanning each in turn
+        void skip() {
+          while (itr_ == srs_->rs_[idx_].end()) {
+            if (++idx_ == srs_->rs_.size()) {
+              itr_ = itr_type();
+              return;
+            }
+            itr_ = srs_->rs_[idx_].begin();
+          }
+        }
+    };
+
+    // TYPES:
+    // Container:
+    typedef typename store_type::value_type value_type;
+    typedef typename store_type::reference reference;
+    typedef typename store_type::const_reference const_reference;
+    typedef Iterator<false> iterator;
+    typedef Iterator<true> const_iterator;
+    typedef typename store_type::difference_type difference_type;
+    typedef typename store_type::size_type size_type;
+    // Other:
+    typedef typename store_type::k_type k_type;
+    typedef typename store_type::v_type v_type;
+
+    // CONSTRUCT/COPY/DESTROY:
+    // Container:
+    ShardedRedisStore() = default;
+    ShardedRedisStore(const ShardedRedisStore& rhs) = default;
+    ShardedRedisStore(ShardedRedisStore&& rhs) : ShardedRedisStore() {
+      swap(rhs);
+    }
+    ShardedRedisStore& operator=(ShardedRedisStore rhs) {
+      swap(rhs);
+      return *this;
+    }
+    ~ShardedRedisStore() = default;
+    // ShardedRedisStore:
+    ShardedRedisStore(const std::vector<std::pair<std::string, unsigned int>>& endpoints,
+        size_t vnodes = 160) : ring_(vnodes) {
+      for (const auto& e : endpoints) {
+        add(e.first, e.second);
+      }
+    }
+
+    // ITERATORS:
+    // Container:
+    iterator begin() {
+      return iterator(this, 0);
+    }
+    const_iterator begin() const {
+      return const_iterator(this, 0);
+    }
+    iterator end() {
+      return iterator(this, rs_.size());
+    }
+    const_iterator end() const {
+      return const_iterator(this, rs_.size());
+    }
+    const_iterator cbegin() const {
+      return begin();
+    }
+    const_iterator cend() const {
+      return end();
+    }
+
+    // CAPACITY:
+    // Container:
+    bool empty() const {
+      return size() == 0;
+    }
+    size_type size() const {
+      size_type res = 0;
+      for (const auto& rs : rs_) {
+        res += rs.size();
+      }
+      return res;
+    }
+    size_type max_size() const {
+      return std::numeric_limits<size_type>::max();
+    }
+
+    // MODIFIERS:
+    // Container:
+    void swap(ShardedRedisStore& rhs) {
+      using std::swap;
+      swap(ring_, rhs.ring_);
+      swap(eps_, rhs.eps_);
+      swap(rs_, rhs.rs_);
+    }
+
+    // STORE INTERFACE:
+    // Common:
+    bool contains(const k_type& k) {
+      return !rs_.empty() && rs_[shard(k)].contains(k);
+    }
+    v_type get(const k_type& k) {
+      return !rs_.empty() ? rs_[shard(k)].get(k) : v_type();
+    }
+    void put(const value_type& v) {
+      if (!rs_.empty()) {
+        rs_[shard(v.first)].put(v);
+      }
+    }
+    void erase(const k_type& k) {
+      if (!rs_.empty()) {
+        rs_[shard(k)].erase(k);
+      }
+    }
+    void clear() {
+      for (auto& rs : rs_) {
+        rs.clear();
+      }
+    }
+    // Batched:
+    template <typename KItr, typename OItr>
+    void multi_contains(KItr begin, KItr end, OItr out) {
+      std::vector<char> res;
+      read(begin, end, res, [](store_type& rs, const std::vector<key_type>& ks, std::vector<char>& cs) {
+        binder::multi_contains(rs, ks.begin(), ks.end(), cs.begin());
+      });
+      for (auto c : res) {
+        *out++ = c != 0;
+      }
+    }
+    template <typename KItr, typename OItr>
+    void multi_get(KItr begin, KItr end, OItr out) {
+      std::vector<val_type> res;
+      read(begin, end, res, [](store_type& rs, const std::vector<key_type>& ks, std::vector<val_type>& vs) {
+        binder::multi_get(rs, ks.begin(), ks.end(), vs.begin());
+      });
+      std::copy(res.begin(), res.end(), out);
+    }
+    template <typename VItr>
+    void multi_put(VItr begin, VItr end) {
+      if (rs_.empty()) {
+        return;
+      }
+      std::vector<std::vector<std::pair<key_type, val_type>>> vs(rs_.size());
+      for (; begin != end; ++begin) {
+        vs[shard(begin->first)].push_back(*begin);
+      }
+      parallel(vs, [&vs](store_type& rs, size_t i) {
+        binder::multi_put(rs, vs[i].begin(), vs[i].end());
+      });
+    }
+    template <typename KItr>
+    void multi_erase(KItr begin, KItr end) {
+      if (rs_.empty()) {
+        return;
+      }
+      std::vector<std::vector<key_type>> ks(rs_.size());
+      for (; begin != end; ++begin) {
+        ks[shard(*begin)].push_back(*begin);
+      }
+      parallel(ks, [&ks](store_type& rs, size_t i) {
+        binder::multi_erase(rs, ks[i].begin(), ks[i].end());
+      });
+    }
+    // ShardedRedisStore:
+    // Keys on the ring segments taken over by (or handed back from) this
+    // endpoint are not migrated
+    void add(const std::string& host, unsigned int port) {
+      eps_.push_back(std::make_pair(host, port));
+      rs_.emplace_back(host, port);
+      ring_.add(host + ":" + std::to_string(port), rs_.size()-1);
+    }
+    void remove(const std::string& host, unsigned int port) {
+      const auto itr = std::find(eps_.begin(), eps_.end(), std::make_pair(host, port));
+      if (itr != eps_.end()) {
+        const size_t i = itr - eps_.begin();
+        ring_.remove(i);
+        eps_.erase(itr);
+        rs_.erase(rs_.begin() + i);
+      }
+    }
+    // A store with its own connections to the same endpoints, for another
+    // thread
+    ShardedRedisStore clone() const {
+      return ShardedRedisStore(*this);
+    }
+    bool is_connected() const {
+      return !rs_.empty() && std::all_of(rs_.begin(), rs_.end(),
+          [](const store_type& rs) { return rs.is_connected(); });
+    }
+    size_t shards() const {
+      return rs_.size();
+    }
+    // The index of the shard which owns k
+    size_t shard(const k_type& k) const {
+      return ring_.find(H()(k));
+    }
+
+    // COMPARISON:
+    // Container:
+    friend bool operator==(const ShardedRedisStore& lhs, const ShardedRedisStore& rhs) {
+      return lhs.eps_ == rhs.eps_;
+    }
+    friend bool operator!=(const ShardedRedisStore& lhs, const ShardedRedisStore& rhs) {
+      return !(lhs == rhs);
+    }
+
+    // SPECIALIZED ALGORITHMS:
+    // Container:
+    friend void swap(ShardedRedisStore& lhs, ShardedRedisStore& rhs) {
+      lhs.swap(rhs);
+    }
+
+  private:
+    typedef typename std::remove_const<k_type>::type key_type;
+    typedef typename std::remove_const<v_type>::type val_type;
+
+    HashRing ring_;
+    std::vector<std::pair<std::string, unsigned int>> eps_;
+    // A deque, so that adding a shard never copies (and so reconnects) the rest
+    std::deque<store_type> rs_;
+
+    // Runs f(rs_[i], i) for every shard with a non-empty split, each on its
+    // own thread but the last, which runs on the calling thread
+    template <typename T, typename F>
+    void parallel(const std::vector<std::vector<T>>& splits, F f) {
+      std::vector<size_t> work;
+      for (size_t i = 0, ie = splits.size(); i < ie; ++i) {
+        if (!splits[i].empty()) {
+          work.push_back(i);
+        }
+      }
+      std::vector<std::future<void>> fs;
+      for (size_t j = 0; j + 1 < work.size(); ++j) {
+        const auto i = work[j];
+        fs.push_back(std::async(std::launch::async, [this, &f, i] { f(rs_[i], i); }));
+      }
+      if (!work.empty()) {
+        f(rs_[work.back()], work.back());
+      }
+      for (auto& fut : fs) {
+        fut.get();
+      }
+    }
+    // Splits a batch of keys by shard, reads each split in parallel with
+    // f(rs, keys, results), and gathers the results back into key order
+    template <typename KItr, typename T, typename F>
+    void read(KItr begin, KItr end, std::vector<T>& res, F f) {
+      std::vector<std::vector<key_type>> ks(rs_.size());
+      std::vector<size_t> owner;
+      for (; begin != end; ++begin) {
+        owner.push_back(rs_.empty() ? 0 : shard(*begin));
+        if (!rs_.empty()) {
+          ks[owner.back()].push_back(*begin);
+        }
+      }
+      res.assign(owner.size(), T());
+      if (rs_.empty()) {
+        return;
+      }
+
+      std::vector<std::vector<T>> rs(rs_.size());
+      parallel(ks, [&ks, &rs, &f](store_type& s, size_t i) {
+        rs[i].resize(ks[i].size());
+        f(s, ks[i], rs[i]);
+      });
+      std::vector<size_t> next(rs_.size(), 0);
+      for (size_t i = 0, ie = owner.size(); i < ie; ++i) {
+        res[i] = rs[owner[i]][next[owner[i]]++];
+      }
+    }
+};
+
+} // namespace binder
+
+#endif
@@ -0,0 +1,252 @@
+#ifndef BINDER_INCLUDE_SHARDED_H
+#define BINDER_INCLUDE_SHARDED_H
+
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <type_traits>
+#include "include/store.h"
+
+namespace binder {
+
+template <typename K, typename V, typename S = UnorderedStore<K,V>, typename H = std::hash<K>>
+class ShardedStore {
+  private:
+    // Padded so that neighboring locks never share a cache line
+    struct Shard {
+      mutable std::shared_timed_mutex m;
+      S s;
+      char pad[64];
+    };
+
+  public:
+    template <bool is_const>
+    class Iterator {
+      friend class ShardedStore;
+      template <bool> friend class Iterator;
+
+      // TYPES:
+      private:
+        typedef typename std::conditional<is_const,
+          typename S::const_iterator, typename S::iterator>::type itr_type;
+        typedef typename std::conditional<is_const,
+          const ShardedStore*, ShardedStore*>::type store_type;
+      public:
+        typedef typename ShardedStore::value_type value_type;
+        typedef typename std::iterator_traits<itr_type>::reference reference;
+        typedef typename std::iterator_traits<itr_type>::pointer pointer;
+        typedef typename ShardedStore::difference_type difference_type;
+        typedef typename std::forward_iterator_tag iterator_category;
+
+      // CONSTRUCT/COPY/DESTROY:
+      private:
+        Iterator(store_type ss, size_t idx) : ss_(ss), idx_(idx) {
+          if (idx_ < ss_->n_) {
+            itr_ = ss_->shards_[idx_].s.begin();
+            skip();
+          }
+        }
+      public:
+        Iterator() : ss_(nullptr), idx_(0) { }
+        Iterator(const Iterator& rhs) = default;
+        template <bool c = is_const, typename = typename std::enable_if<c>::type>
+        Iterator(const Iterator<false>& rhs) : ss_(rhs.ss_), idx_(rhs.idx_), itr_(rhs.itr_) { }
+        Iterator& operator=(const Iterator& rhs) = default;
+
+        // ABILITIES:
+        reference operator*() const {
+          return *itr_;
+        }
+        pointer operator->() const {
+          return itr_.operator->();
+        }
+        Iterator& operator++() {
+          ++itr_;
+          skip();
+          return *this;
+        }
+        Iterator operator++(int) {
+          auto ret = *this;
+          ++(*this);
+          return ret;
+        }
+        bool operator==(const Iterator& rhs) const {
+          return idx_ == rhs.idx_ && (ss_ == nullptr || idx_ == ss_->n_ || itr_ == rhs.itr_);
+        }
+        bool operator!=(const Iterator& rhs) const {
+          return !(*this == rhs);
+        }
+
+      private:
+        store_type ss_;
+        size_t idx_;
+        itr_type itr_;
+
+        void skip() {
+          while (itr_ == ss_->shards_[idx_].s.end()) {
+            if (++idx_ == ss_->n_) {
+              itr_ = itr_type();
+              return;
+            }
+            itr_ = ss_->shards_[idx_].s.begin();
+          }
+        }
+    };
+
+    // TYPES:
+    // Container:
+    typedef typename S::value_type value_type;
+    typedef typename S::reference reference;
+    typedef typename S::const_reference const_reference;
+    typedef Iterator<false> iterator;
+    typedef Iterator<true> const_iterator;
+    typedef typename S::difference_type difference_type;
+    typedef typename S::size_type size_type;
+    // Other:
+    typedef typename S::k_type k_type;
+    typedef typename S::v_type v_type;
+
+    // CONSTRUCT/COPY/DESTROY:
+    // Container:
+    ShardedStore(size_t n = 64) : n_(1), shards_(nullptr) {
+      while (n_ < n) {
+        n_ *= 2;
+      }
+      shards_.reset(new Shard[n_]);
+    }
+    ShardedStore(const ShardedStore& rhs) : ShardedStore(rhs.n_) {
+      for (size_t i = 0; i < n_; ++i) {
+        std::shared_lock<std::shared_timed_mutex> lock(rhs.shards_[i].m);
+        shards_[i].s = rhs.shards_[i].s;
+      }
+    }
+    ShardedStore(ShardedStore&& rhs) : n_(0), shards_(nullptr) {
+      swap(rhs);
+    }
+    ShardedStore& operator=(ShardedStore rhs) {
+      swap(rhs);
+      return *this;
+    }
+    ~ShardedStore() = default;
+
+    // ITERATORS:
+    // Container:
+    iterator begin() {
+      return iterator(this, 0);
+    }
+    const_iterator begin() const {
+      return const_iterator(this, 0);
+    }
+    iterator end() {
+      return iterator(this, n_);
+    }
+    const_iterator end() const {
+      return const_iterator(this, n_);
+    }
+    const_iterator cbegin() const {
+      return begin();
+    }
+    const_iterator cend() const {
+      return end();
+    }
+
+    // CAPACITY:
+    // Container:
+    bool empty() const {
+      return size() == 0;
+    }
+    size_type size() const {
+      size_type res = 0;
+      for (size_t i = 0; i < n_; ++i) {
+        std::shared_lock<std::shared_timed_mutex> lock(shards_[i].m);
+        res += shards_[i].s.size();
+      }
+      return res;
+    }
+    size_type max_size() const {
+      return std::numeric_limits<size_type>::max();
+    }
+
+    // MODIFIERS:
+    // Container:
+    void swap(ShardedStore& rhs) {
+      using std::swap;
+      swap(n_, rhs.n_);
+      swap(shards_, rhs.shards_);
+    }
+
+    // STORE INTERFACE:
+    // Common:
+    bool contains(const k_type& k) {
+      auto& sh = shard(k);
+      std::shared_lock<std::shared_timed_mutex> lock(sh.m);
+      return sh.s.contains(k);
+    }
+    v_type get(const k_type& k) {
+      auto& sh = shard(k);
+      std::shared_lock<std::shared_timed_mutex> lock(sh.m);
+      return sh.s.get(k);
+    }
+    void put(const value_type& v) {
+      auto& sh = shard(v.first);
+      std::lock_guard<std::shared_timed_mutex> lock(sh.m);
+      sh.s.put(v);
+    }
+    void erase(const k_type& k) {
+      auto& sh = shard(k);
+      std::lock_guard<std::shared_timed_mutex> lock(sh.m);
+      sh.s.erase(k);
+    }
+    void clear() {
+      for (size_t i = 0; i < n_; ++i) {
+        std::lock_guard<std::shared_timed_mutex> lock(shards_[i].m);
+        shards_[i].s.clear();
+      }
+    }
+    // ShardedStore:
+    size_t shards() const {
+      return n_;
+    }
+
+    // COMPARISON:
+    // Container:
+    friend bool operator==(const ShardedStore& lhs, const ShardedStore& rhs) {
+      if (lhs.n_ != rhs.n_) {
+        return false;
+      }
+      for (size_t i = 0; i < lhs.n_; ++i) {
+        if (lhs.shards_[i].s != rhs.shards_[i].s) {
+          return false;
+        }
+      }
+      return true;
+    }
+    friend bool operator!=(const ShardedStore& lhs, const ShardedStore& rhs) {
+      return !(lhs == rhs);
+    }
+
+    // SPECIALIZED ALGORITHMS:
+    // Container:
+    friend void swap(ShardedStore& lhs, ShardedStore& rhs) {
+      lhs.swap(rhs);
+    }
+
+  private:
+    size_t n_;
+    std::unique_ptr<Shard[]> shards_;
+
+    Shard& shard(const k_type& k) {
+      // Fibonacci hashing on the top bits keeps shard selection independent
+      // of whatever bits the inner store hashes on
+      const uint64_t h = H()(k) * 0x9e3779b97f4a7c15ull;
+      return shards_[n_ == 1 ? 0 : h >> (64 - __builtin_ctzll(n_))];
+    }
+};
+
+} // namespace binder
+
+#endif
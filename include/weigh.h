@@ -0,0 +1,38 @@
+#ifndef BINDER_INCLUDE_WEIGH_H
+#define BINDER_INCLUDE_WEIGH_H
+
+#include <cstddef>
+
+namespace binder {
+
+// Counts every entry once, so that capacity is a number of entries
+template <typename S>
+struct Unit {
+  size_t operator()(const typename S::value_type&) const {
+    return 1;
+  }
+};
+
+// Weighs entries by their size in bytes. This is the size of the entry itself
+// plus, for keys and values which are contiguous containers such as strings
+// and vectors, the size of their elements.
+template <typename S>
+struct Sizeof {
+  size_t operator()(const typename S::value_type& v) const {
+    return sizeof(v) + elements(v.first, 0) + elements(v.second, 0);
+  }
+
+  template <typename T>
+  static auto elements(const T& t, int)
+      -> decltype(t.size() * sizeof(*t.data())) {
+    return t.size() * sizeof(*t.data());
+  }
+  template <typename T>
+  static size_t elements(const T&, long) {
+    return 0;
+  }
+};
+
+} // namespace binder
+
+#endif
@@ -1,7 +1,15 @@
 #ifndef BINDER_INCLUDE_WRITE_H
 #define BINDER_INCLUDE_WRITE_H
 
+#include <condition_variable>
+#include <exception>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "include/multi.h"
 
 namespace binder {
 
@@ -10,10 +18,18 @@ struct WriteThrough {
   void modify(S& s, const typename S::value_type& v) {
     s.put(v);
   }
-  void flush(S& s, const typename S::k_type& k) {
+  template <typename VItr>
+  void modify(S& s, VItr begin, VItr end) {
+    binder::multi_put(s, begin, end);
+  }
+  void flush(S&, const typename S::k_type&) {
+    // Does nothing.
+  }
+  template <typename KItr>
+  void flush(S&, KItr, KItr) {
     // Does nothing.
   }
-  friend void swap(WriteThrough& lhs, WriteThrough& rhs) {
+  friend void swap(WriteThrough&, WriteThrough&) {
     // Does nothing.
   }
 };
@@ -21,9 +37,13 @@ struct WriteThrough {
 template <typename S>
 class WriteBack {
   public:
-    void modify(S& s, const typename S::value_type& v) {
+    void modify(S&, const typename S::value_type& v) {
       vs_.insert(v);
     }
+    template <typename VItr>
+    void modify(S&, VItr begin, VItr end) {
+      vs_.insert(begin, end);
+    }
     void flush(S& s, const typename S::k_type& k) {
       auto itr = vs_.find(k);
       if (itr != vs_.end()) {
@@ -31,6 +51,18 @@ class WriteBack {
         vs_.erase(itr);
       }
     }
+    template <typename KItr>
+    void flush(S& s, KItr begin, KItr end) {
+      std::vector<typename S::value_type> dirty;
+      for (; begin != end; ++begin) {
+        auto itr = vs_.find(*begin);
+        if (itr != vs_.end()) {
+          dirty.push_back(*itr);
+          vs_.erase(itr);
+        }
+      }
+      binder::multi_put(s, dirty.begin(), dirty.end());
+    }
     friend void swap(WriteBack& lhs, WriteBack& rhs) {
       using std::swap;
       swap(lhs.vs_, rhs.vs_);
@@ -40,6 +72,217 @@ class WriteBack {
     std::map<typename S::k_type, typename S::v_type> vs_;
 };
 
+// Stores holding a connection which must not be shared between threads may
+// provide clone(), which returns a store with a connection of its own to the
+// same data
+template <typename S>
+auto clone(const S& s, int) -> decltype(s.clone(), std::unique_ptr<S>()) {
+  return std::unique_ptr<S>(new S(s.clone()));
+}
+template <typename S>
+std::unique_ptr<S> clone(const S&, long) {
+  return nullptr;
+}
+template <typename S>
+std::unique_ptr<S> clone(const S& s) {
+  return clone(s, 0);
+}
+
+// Write policies which hold values back from the backing store may provide
+// queued(k, v), which reads the value still waiting to be written for k and
+// reports whether there was one. Caches consult it before fetching a miss,
+// since the backing store may not have the value yet.
+template <typename W, typename K, typename V>
+auto queued(W& w, const K& k, V& v, int) -> decltype(w.queued(k, v)) {
+  return w.queued(k, v);
+}
+template <typename W, typename K, typename V>
+bool queued(W&, const K&, V&, long) {
+  return false;
+}
+template <typename W, typename K, typename V>
+bool queued(W& w, const K& k, V& v) {
+  return queued(w, k, v, 0);
+}
+
+// Writes dirty values to the backing store from a background thread. Repeated
+// writes to a key which is still waiting are coalesced into one, and whatever
+// has accumulated while the last batch was written goes out as the next batch,
+// with one multi_put(). modify() only blocks once limit keys are waiting, so
+// foreground writes don't wait on the backing store until it falls behind.
+// Every dirty value is queued as it is modified, so flush() has nothing left
+// to do and returns at once, and an eviction never waits on the backing store.
+// A miss which follows an eviction reads the key from the queue with queued()
+// until it has been written, so never reads a stale value. sync() waits for
+// every key. The backing store is written from the writer thread while the
+// cache reads it from its own, so it must be safe to use from two threads at
+// once, as ShardedStore is, unless it provides clone().
+template <typename S>
+class WriteBehind {
+  private:
+    typedef typename std::remove_const<typename S::k_type>::type key_type;
+    typedef typename std::remove_const<typename S::v_type>::type val_type;
+
+  public:
+    explicit WriteBehind(size_t limit = 4096) : q_(new Queue(limit)) { }
+    // Copies start out clean; values waiting in rhs are still written by rhs
+    WriteBehind(const WriteBehind& rhs) : WriteBehind(rhs.q_->limit) { }
+    WriteBehind(WriteBehind&& rhs) = default;
+    WriteBehind& operator=(WriteBehind rhs) {
+      swap(*this, rhs);
+      return *this;
+    }
+    ~WriteBehind() = default;
+
+    void modify(S& s, const typename S::value_type& v) {
+      std::unique_lock<std::mutex> lock(q_->m);
+      target(s, lock);
+      q_->done.wait(lock, [&]{ return q_->pending.size() < q_->limit || q_->pending.count(v.first) != 0; });
+      q_->put(v);
+    }
+    template <typename VItr>
+    void modify(S& s, VItr begin, VItr end) {
+      std::unique_lock<std::mutex> lock(q_->m);
+      target(s, lock);
+      for (; begin != end; ++begin) {
+        q_->done.wait(lock, [&]{ return q_->pending.size() < q_->limit || q_->pending.count(begin->first) != 0; });
+        q_->put(*begin);
+      }
+    }
+    void flush(S&, const typename S::k_type&) {
+      // Does nothing.
+    }
+    template <typename KItr>
+    void flush(S&, KItr, KItr) {
+      // Does nothing.
+    }
+    // Reads the value waiting to be written for k, the latest modified first
+    bool queued(const typename S::k_type& k, val_type& v) const {
+      std::lock_guard<std::mutex> lock(q_->m);
+      auto itr = q_->pending.find(k);
+      if (itr == q_->pending.end() && (itr = q_->writing.find(k)) == q_->writing.end()) {
+        return false;
+      }
+      v = itr->second;
+      return true;
+    }
+    // Waits until every value modified so far has been written
+    void sync() {
+      std::unique_lock<std::mutex> lock(q_->m);
+      q_->done.wait(lock, [&]{ return q_->pending.empty() && q_->writing.empty(); });
+    }
+    // The number of values and batches written so far
+    size_t writes() const {
+      std::lock_guard<std::mutex> lock(q_->m);
+      return q_->writes;
+    }
+    size_t batches() const {
+      std::lock_guard<std::mutex> lock(q_->m);
+      return q_->batches;
+    }
+    // The number of values which were dropped because writing their batch
+    // threw, and the last exception thrown
+    size_t errors() const {
+      std::lock_guard<std::mutex> lock(q_->m);
+      return q_->errors;
+    }
+    std::exception_ptr error() const {
+      std::lock_guard<std::mutex> lock(q_->m);
+      return q_->error;
+    }
+    friend void swap(WriteBehind& lhs, WriteBehind& rhs) {
+      using std::swap;
+      swap(lhs.q_, rhs.q_);
+    }
+
+  private:
+    // Shared with the writer thread, so that it stays put if the policy moves
+    struct Queue {
+      mutable std::mutex m;
+      // Signalled when there is work, and when work has been done
+      std::condition_variable work;
+      std::condition_variable done;
+      std::map<key_type, val_type> pending;
+      std::map<key_type, val_type> writing;
+      // The store being written, and the clone of it which the writer uses
+      // in its place, if it provides one
+      S* s;
+      std::unique_ptr<S> c;
+      size_t limit;
+      size_t writes;
+      size_t batches;
+      size_t errors;
+      std::exception_ptr error;
+      bool stop;
+      std::thread t;
+
+      Queue(size_t l) : s(nullptr), limit(l), writes(0), batches(0), errors(0), stop(false) { }
+      ~Queue() {
+        if (t.joinable()) {
+          {
+            std::lock_guard<std::mutex> lock(m);
+            stop = true;
+          }
+          work.notify_one();
+          t.join();
+        }
+      }
+
+      void put(const typename S::value_type& v) {
+        auto itr = pending.insert(v);
+        if (!itr.second) {
+          itr.first->second = v.second;
+        }
+        work.notify_one();
+      }
+      void run() {
+        std::unique_lock<std::mutex> lock(m);
+        while (true) {
+          work.wait(lock, [&]{ return stop || !pending.empty(); });
+          if (pending.empty()) {
+            return;
+          }
+          writing.swap(pending);
+          done.notify_all();
+          auto w = c ? c.get() : s;
+          lock.unlock();
+          std::exception_ptr e;
+          try {
+            binder::multi_put(*w, writing.begin(), writing.end());
+          } catch (...) {
+            e = std::current_exception();
+          }
+          lock.lock();
+          if (e) {
+            errors += writing.size();
+            error = e;
+          } else {
+            writes += writing.size();
+          }
+          ++batches;
+          writing.clear();
+          done.notify_all();
+        }
+      }
+    };
+
+    std::unique_ptr<Queue> q_;
+
+    // Points the writer at s, starting it on first use. If s is a different
+    // store from before, whatever is waiting is written to the old one first.
+    void target(S& s, std::unique_lock<std::mutex>& lock) {
+      if (q_->s == &s) {
+        return;
+      }
+      q_->done.wait(lock, [&]{ return q_->pending.empty() && q_->writing.empty(); });
+      q_->s = &s;
+      q_->c = binder::clone(s);
+      if (!q_->t.joinable()) {
+        q_->t = std::thread(&Queue::run, q_.get());
+      }
+    }
+};
+
 } // namespace binder
 
 #endif
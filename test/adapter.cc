@@ -12,6 +12,13 @@ TEST(adapter_store, basic) {
   basic(s);
 }
 
+// Batched test
+TEST(adapter_store, batched) {
+  Store<int, double> id;
+  AdapterStore<char, int, decltype(id)> s(&id);
+  batched(s);
+}
+
 // Backing store test
 TEST(adapter_store, backing_store) {
   Store<int, int> ii;
@@ -75,3 +82,117 @@ TEST(adapter, many_to_one) {
   EXPECT_EQ(s.get(1), 1);
   EXPECT_EQ(s.get(3), 1);
 }
+
+// Stateful map test
+TEST(adapter_store, stateful) {
+  struct M {
+    int offset;
+    int kmap(int dk) { return dk + offset; }
+    int vmap(int dv) { return dv; }
+    int kunmap(int rk) { return rk - offset; }
+    int vunmap(int rv) { return rv; }
+    int vunmap(int, int, int rv) { return rv; }
+  };
+  Store<int, int> ii;
+  AdapterStore<int, int, decltype(ii), M> s(&ii, M{100});
+
+  s.put(make_pair(1, 2));
+  EXPECT_TRUE(ii.contains(101));
+  EXPECT_EQ(s.get(1), 2);
+
+  // Dereferencing an iterator again yields the same value
+  auto i = s.begin();
+  EXPECT_EQ(i->first, 1);
+  EXPECT_EQ(&*i, &*i);
+  EXPECT_EQ((*i).second, 2);
+  const auto copy = i;
+  EXPECT_EQ(copy->first, 1);
+  EXPECT_EQ(++i, s.end());
+
+  // The map is swapped along with the backing store
+  Store<int, int> jj;
+  AdapterStore<int, int, decltype(jj), M> t(&jj, M{-100});
+  swap(s, t);
+  t.put(make_pair(2, 3));
+  EXPECT_TRUE(ii.contains(102));
+}
+
+// Bulk conversion tests
+template <typename From, typename To>
+void check_cast_n(const vector<From>& in) {
+  vector<To> out(in.size());
+  cast_n(in.data(), in.size(), out.data());
+  for (size_t i = 0; i < in.size(); ++i) {
+    EXPECT_EQ(out[i], (To) in[i]) << i;
+  }
+}
+TEST(adapter_store, cast_n) {
+  // Lengths which leave a tail after the vectorized part
+  vector<double> ds;
+  vector<int32_t> is;
+  for (int i = 0; i < 11; ++i) {
+    ds.push_back((i - 5) * 2.75);
+    is.push_back((i - 5) * 1000003);
+  }
+  const vector<float> fs(ds.begin(), ds.end());
+  check_cast_n<double, int32_t>(ds);
+  check_cast_n<int32_t, double>(is);
+  check_cast_n<float, int32_t>(fs);
+  check_cast_n<int32_t, float>(is);
+  check_cast_n<double, int64_t>(ds);
+  check_cast_n<double, double>(ds);
+  check_cast_n<char, int>(vector<char>({'a', 'b', 'c'}));
+}
+TEST(adapter_store, bulk) {
+  struct M {
+    size_t* bulk;
+    size_t* single;
+    int kmap(double dk) { ++*single; return (int) (dk * 100); }
+    int vmap(double dv) { ++*single; return (int) (dv * 100); }
+    double kunmap(int rk) { return rk / 100.0; }
+    double vunmap(int rv) { return rv / 100.0; }
+    double vunmap(double, int, int rv) { ++*single; return rv / 100.0; }
+    void kmap_n(const double* dk, size_t n, int* rk) {
+      ++*bulk;
+      for (size_t i = 0; i < n; ++i) {
+        rk[i] = (int) (dk[i] * 100);
+      }
+    }
+    void vmap_n(const double* dv, size_t n, int* rv) {
+      ++*bulk;
+      for (size_t i = 0; i < n; ++i) {
+        rv[i] = (int) (dv[i] * 100);
+      }
+    }
+    void vunmap_n(const double*, const int*, const int* rv, size_t n, double* dv) {
+      ++*bulk;
+      for (size_t i = 0; i < n; ++i) {
+        dv[i] = rv[i] / 100.0;
+      }
+    }
+  };
+  size_t bulk = 0;
+  size_t single = 0;
+  Store<int, int> ii;
+  AdapterStore<double, double, decltype(ii), M> s(&ii, M{&bulk, &single});
+
+  // Batches are converted with one call to each bulk form
+  vector<pair<double, double>> vs = {{0.5, 1.5}, {1.25, 2.5}, {2.0, 3.75}};
+  s.multi_put(vs.begin(), vs.end());
+  EXPECT_EQ(bulk, 2);
+  EXPECT_EQ(ii.get(125), 250);
+  vector<double> ks = {0.5, 1.25, 2.0, 3.0};
+  vector<double> gs;
+  s.multi_get(ks.begin(), ks.end(), back_inserter(gs));
+  EXPECT_EQ(gs, vector<double>({1.5, 2.5, 3.75, 0}));
+  EXPECT_EQ(bulk, 4);
+  s.multi_erase(ks.begin(), ks.begin() + 1);
+  EXPECT_EQ(bulk, 5);
+  EXPECT_FALSE(ii.contains(50));
+  EXPECT_EQ(single, 0);
+
+  // Single-key calls still use the per-element forms
+  s.put(make_pair(4.0, 5.0));
+  EXPECT_EQ(s.get(4.0), 5.0);
+  EXPECT_EQ(single, 4);
+}
@@ -0,0 +1,127 @@
+#include <cmath>
+#include <random>
+#include <vector>
+#include "gtest/gtest.h"
+#include "include/admit.h"
+#include "include/cache.h"
+#include "include/store.h"
+#include "test/interface.h"
+
+using namespace binder;
+
+// TinyLfu sketch test
+TEST(admit, tiny_lfu) {
+  TinyLfu<Store<int, int>> a(1024);
+
+  // The first access only reaches the doorkeeper
+  EXPECT_EQ(a.frequency(1), 0);
+  a.record(1);
+  EXPECT_EQ(a.frequency(1), 1);
+  for (int i = 0; i < 5; ++i) {
+    a.record(1);
+  }
+  EXPECT_EQ(a.frequency(1), 6);
+  a.record(2);
+  EXPECT_TRUE(a.admit(1, 2));
+  EXPECT_FALSE(a.admit(2, 1));
+  EXPECT_FALSE(a.admit(3, 2));
+
+  // Counters saturate
+  for (int i = 0; i < 20; ++i) {
+    a.record(3);
+  }
+  EXPECT_EQ(a.frequency(3), 16);
+
+  // And age, along with the doorkeeper
+  for (int i = 0; i < 10 * 1024; ++i) {
+    a.record(4);
+  }
+  EXPECT_EQ(a.frequency(3), 7);
+  EXPECT_EQ(a.frequency(1), 2);
+}
+
+// Draws n keys from a Zipfian distribution over [0, m) with exponent s
+vector<int> zipf(size_t n, size_t m, double s) {
+  vector<double> cdf;
+  double sum = 0;
+  for (size_t i = 1; i <= m; ++i) {
+    sum += 1 / pow(i, s);
+    cdf.push_back(sum);
+  }
+  mt19937 gen(42);
+  uniform_real_distribution<double> u(0, sum);
+  vector<int> res;
+  for (size_t i = 0; i < n; ++i) {
+    res.push_back(lower_bound(cdf.begin(), cdf.end(), u(gen)) - cdf.begin());
+  }
+  return res;
+}
+
+// Returns the fraction of gets which hit in s
+template <typename C>
+double hit_ratio(C& s, const vector<int>& trace) {
+  size_t hits = 0;
+  for (auto k : trace) {
+    hits += s.contains(k);
+    EXPECT_EQ(s.get(k), k+1);
+  }
+  return (double)hits / trace.size();
+}
+
+// Admission test
+TEST(admit, cache) {
+  Store<int, int> b;
+  for (int i = 0; i < 10000; ++i) {
+    b.put(make_pair(i, i+1));
+  }
+  const auto trace = zipf(200000, 10000, 0.9);
+
+  Store<int, int> p1;
+  Cache<decltype(p1), decltype(b)> s1(&p1, &b, 100);
+  const auto lru = hit_ratio(s1, trace);
+
+  Store<int, int> p2;
+  Cache<decltype(p2), decltype(b), Lru<decltype(p2)>, Fetch<decltype(b)>,
+    WriteThrough<decltype(b)>, TinyLfu<decltype(p2)>> s2(&p2, &b, 100);
+  const auto lfu = hit_ratio(s2, trace);
+  EXPECT_LE(p2.size(), 100);
+  EXPECT_GT(lfu, lru + 0.05);
+
+  // Rejected writes still reach the backing store
+  s2.put(make_pair(-1, 42));
+  EXPECT_FALSE(s2.contains(-1));
+  EXPECT_TRUE(b.contains(-1));
+  EXPECT_EQ(b.get(-1), 42);
+  EXPECT_EQ(s2.get(-1), 42);
+
+  // As a cache policy
+  Store<char, int> ci1;
+  Store<char, int> ci2;
+  Cache<decltype(ci1), decltype(ci2), Lru<decltype(ci1)>, Fetch<decltype(ci2)>,
+    WriteThrough<decltype(ci2)>, TinyLfu<decltype(ci1)>> s(&ci1, &ci2, 26);
+  basic(s);
+}
+
+// Rejection test
+TEST(admit, reject) {
+  // A rejected candidate leaves the evict policy as it was, neither clearing
+  // reference bits nor moving the hand, so 1 is still the next victim
+  Store<int, int> p;
+  Store<int, int> b;
+  Cache<decltype(p), decltype(b), Clock<decltype(p)>, Fetch<decltype(b)>,
+    WriteThrough<decltype(b)>, TinyLfu<decltype(p)>> s(&p, &b, 2);
+  s.put(make_pair(1, 1));
+  s.put(make_pair(2, 2));
+  for (int i = 0; i < 4; ++i) {
+    s.get(1);
+    s.get(2);
+  }
+  s.put(make_pair(3, 3));
+  EXPECT_FALSE(p.contains(3));
+  s.get(1);
+  while (!p.contains(4)) {
+    s.put(make_pair(4, 4));
+  }
+  EXPECT_FALSE(p.contains(1));
+  EXPECT_TRUE(p.contains(2));
+}
@@ -0,0 +1,80 @@
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include "gtest/gtest.h"
+#include "include/redis.h"
+
+using namespace binder;
+using namespace std;
+
+// This binary replaces the global allocator to count heap allocations, and
+// so is built apart from the other tests
+static atomic<size_t> allocs(0);
+void* operator new(size_t n) {
+  ++allocs;
+  if (void* p = malloc(n == 0 ? 1 : n)) {
+    return p;
+  }
+  throw bad_alloc();
+}
+// Kept out of line so that gcc doesn't pair an inlined free() with new
+__attribute__((noinline)) void operator delete(void* p) noexcept {
+  free(p);
+}
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept {
+  free(p);
+}
+
+// Binary codec allocation test
+TEST(redis_codec, binary_allocs) {
+  typedef RedisCodec<string, double, Binary<string, double>> codec;
+  const string k(64, 'k');
+  const double v = 2.5;
+  redisReply rep;
+  memset(&rep, 0, sizeof(rep));
+  rep.type = REDIS_REPLY_STRING;
+  rep.str = (char*)&v;
+  rep.len = sizeof(v);
+
+  // Once the buffer has grown, encoding a key and decoding a value (the work
+  // done by get() besides the round trip) never touch the heap
+  string buf;
+  codec::kwrite(buf, k);
+  const size_t before = allocs;
+  double sum = 0;
+  for (size_t i = 0; i < 1000; ++i) {
+    codec::kwrite(buf, k);
+    sum += codec::vread(&rep);
+  }
+  const size_t after = allocs;
+  EXPECT_EQ(after - before, 0);
+  EXPECT_EQ(sum, 2500);
+
+  // Whereas the stream codec allocates on every call
+  typedef RedisCodec<string, double, Stream<string, double>> scodec;
+  const size_t sbefore = allocs;
+  scodec::kwrite(buf, k);
+  EXPECT_GT(allocs - sbefore, 0);
+}
+
+// RedisStore::get allocation test
+TEST(redis_store, get_allocs) {
+  RedisStore<int64_t, double, Binary<int64_t, double>> s("localhost", 6379);
+  s.put(make_pair(7, 2.5));
+  EXPECT_EQ(s.get(7), 2.5);
+
+  // hiredis allocates its replies with malloc, so only the store's own
+  // allocations are counted. Once the key buffer has grown there are none.
+  const size_t before = allocs;
+  double sum = 0;
+  for (size_t i = 0; i < 1000; ++i) {
+    sum += s.get(7);
+  }
+  const size_t after = allocs;
+  EXPECT_EQ(after - before, 0);
+  EXPECT_EQ(sum, 2500);
+  s.erase(7);
+}
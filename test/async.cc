@@ -0,0 +1,89 @@
+#include <future>
+#include <vector>
+#include "gtest/gtest.h"
+#include "include/async.h"
+
+using namespace binder;
+using namespace std;
+
+// Connection test
+TEST(async_redis_store, connection) {
+  AsyncRedisStore<int, int> s;
+  EXPECT_FALSE(s.is_connected());
+  s.connect("localhost", 1);
+  EXPECT_FALSE(s.is_connected());
+  s.connect("localhost", 6379);
+  EXPECT_TRUE(s.is_connected());
+  s.disconnect();
+  EXPECT_FALSE(s.is_connected());
+
+  // Requests against a disconnected store resolve immediately
+  EXPECT_FALSE(s.put_async(make_pair(1, 1)).get());
+  EXPECT_FALSE(s.contains_async(1).get());
+  EXPECT_EQ(s.get_async(1).get(), int());
+}
+
+// Futures test
+TEST(async_redis_store, futures) {
+  RedisStore<int, int> rs("localhost", 6379);
+  rs.clear();
+  AsyncRedisStore<int, int> s("localhost", 6379);
+
+  // Many requests outstanding at once
+  vector<future<bool>> puts;
+  for (int i = 0; i < 1000; ++i) {
+    puts.push_back(s.put_async(make_pair(i, i+1)));
+  }
+  auto erase = s.erase_async(0);
+  vector<future<int>> gets;
+  for (int i = 0; i < 1000; ++i) {
+    gets.push_back(s.get_async(i));
+  }
+  auto c0 = s.contains_async(0);
+  auto c1 = s.contains_async(1);
+
+  for (auto& p : puts) {
+    EXPECT_TRUE(p.get());
+  }
+  EXPECT_TRUE(erase.get());
+  EXPECT_EQ(gets[0].get(), int());
+  for (int i = 1; i < 1000; ++i) {
+    EXPECT_EQ(gets[i].get(), i+1);
+  }
+  EXPECT_FALSE(c0.get());
+  EXPECT_TRUE(c1.get());
+  EXPECT_EQ(rs.size(), 999);
+}
+
+// A fire-and-forget coroutine which reports its result through a promise
+struct Task {
+  struct promise_type {
+    Task get_return_object() { return {}; }
+    std::suspend_never initial_suspend() { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() { }
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+Task round_trip(AsyncRedisStore<int, int>& s, promise<int>& res) {
+  co_await s.co_put(make_pair(7, 8));
+  const auto c = co_await s.co_contains(7);
+  const auto v = co_await s.co_get(7);
+  co_await s.co_erase(7);
+  res.set_value(c ? v : -1);
+}
+
+// Coroutine test
+TEST(async_redis_store, coroutines) {
+  AsyncRedisStore<int, int> s("localhost", 6379);
+  promise<int> res;
+  round_trip(s, res);
+  EXPECT_EQ(res.get_future().get(), 8);
+  EXPECT_FALSE(s.contains_async(7).get());
+
+  // Requests against a disconnected store complete without suspending
+  s.disconnect();
+  promise<int> none;
+  round_trip(s, none);
+  EXPECT_EQ(none.get_future().get(), -1);
+}
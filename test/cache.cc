@@ -1,3 +1,8 @@
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
 #include "gtest/gtest.h"
 #include "include/cache.h"
 #include "include/store.h"
@@ -42,6 +47,47 @@ TEST(cache, basic) {
   basic(s);
 }
 
+// Batched tests
+TEST(cache, batched) {
+  Store<char, int> ci1;
+  Store<char, int> ci2;
+  Cache<decltype(ci1),decltype(ci2)> s(&ci1, &ci2, 26);
+  batched(s);
+}
+// Counts round trips to the backing store
+struct Counted : Store<int, int> {
+  size_t gets = 0;
+  template <typename KItr, typename OItr>
+  void multi_get(KItr begin, KItr end, OItr out) {
+    ++gets;
+    for (; begin != end; ++begin) {
+      *out++ = get(*begin);
+    }
+  }
+};
+TEST(cache, batched_fetch) {
+  Store<int, int> ii1;
+  Counted ii2;
+  Cache<Store<int,int>, Counted, Lru<Store<int,int>>, Fetch<Counted>> s(&ii1, &ii2, 4);
+  for (int i = 0; i < 8; ++i) {
+    ii2.put(make_pair(i, i+1));
+  }
+  s.get(0);
+  s.get(1);
+
+  // Two hits, five misses, and one key which is missing everywhere
+  vector<int> ks = {0, 1, 2, 3, 4, 5, 6, 9};
+  vector<int> vs;
+  s.multi_get(ks.begin(), ks.end(), back_inserter(vs));
+  EXPECT_EQ(ii2.gets, 1);
+  for (size_t i = 0; i < 7; ++i) {
+    EXPECT_EQ(vs[i], ks[i]+1);
+  }
+  EXPECT_EQ(vs[7], 0);
+  EXPECT_EQ(s.size(), 4);
+  EXPECT_FALSE(s.contains(9));
+}
+
 // Evict policy tests
 TEST(cache, lru) {
   Store<int, int> ii1;
@@ -76,6 +122,64 @@ TEST(cache, fetch) {
   EXPECT_FALSE(s.contains(2));
 }
 
+// Counts reads from the backing store
+struct CountedReads : Store<int, int> {
+  size_t reads = 0;
+  bool contains(const int& k) {
+    ++reads;
+    return Store<int, int>::contains(k);
+  }
+};
+TEST(cache, negative) {
+  typedef Negative<CountedReads> R;
+  Store<int, int> ii1;
+  CountedReads ii2;
+  Cache<Store<int,int>, CountedReads, Lru<Store<int,int>>, R> s(&ii1, &ii2);
+  ii2.put(make_pair(1, 2));
+
+  // Repeated misses on an absent key reach the backing store once
+  EXPECT_EQ(s.get(3), 0);
+  EXPECT_EQ(s.get(3), 0);
+  EXPECT_EQ(ii2.reads, 1);
+  vector<int> ks = {1, 3, 4};
+  vector<int> vs;
+  s.multi_get(ks.begin(), ks.end(), back_inserter(vs));
+  EXPECT_EQ(vs, vector<int>({2, 0, 0}));
+  EXPECT_EQ(ii2.reads, 3);
+  vs.clear();
+  s.multi_get(ks.begin() + 1, ks.end(), back_inserter(vs));
+  EXPECT_EQ(vs, vector<int>({0, 0}));
+  EXPECT_EQ(ii2.reads, 3);
+
+  // Putting a key forgets that it was missing
+  s.put(make_pair(3, 4));
+  s.erase(3);
+  EXPECT_EQ(s.get(3), 4);
+  EXPECT_EQ(ii2.reads, 4);
+
+  // Missing keys are forgotten beyond capacity
+  R r1(2);
+  for (int k = 10; k < 13; ++k) {
+    r1.fetch(ii2, k);
+  }
+  EXPECT_EQ(r1.size(), 2);
+  ii2.reads = 0;
+  r1.fetch(ii2, 12);
+  EXPECT_EQ(ii2.reads, 0);
+  r1.fetch(ii2, 10);
+  EXPECT_EQ(ii2.reads, 1);
+
+  // And once they expire
+  R r2(16, chrono::milliseconds(20));
+  r2.fetch(ii2, 10);
+  r2.fetch(ii2, 10);
+  EXPECT_EQ(ii2.reads, 2);
+  this_thread::sleep_for(chrono::milliseconds(30));
+  r2.fetch(ii2, 10);
+  EXPECT_EQ(ii2.reads, 3);
+  EXPECT_EQ(r2.begin(), r2.end());
+}
+
 // Write policy tests
 TEST(cache, write_through) {
   Store<int, int> ii1;
@@ -110,3 +214,202 @@ TEST(cache, write_back) {
   EXPECT_TRUE(ii2.contains(1));
   EXPECT_FALSE(s.contains(1));
 }
+
+// Watermark tests
+struct CountedPuts : Store<int, int> {
+  vector<size_t> batches;
+  template <typename VItr>
+  void multi_put(VItr begin, VItr end) {
+    batches.push_back(distance(begin, end));
+    for (; begin != end; ++begin) {
+      put(*begin);
+    }
+  }
+};
+TEST(cache, watermark) {
+  Store<int, int> ii1;
+  CountedPuts ii2;
+  Cache<Store<int,int>, CountedPuts, Lru<Store<int,int>>, Fetch<CountedPuts>,
+    WriteBack<CountedPuts>> s(&ii1, &ii2, 8);
+  s.watermark(4);
+
+  for (int i = 0; i < 8; ++i) {
+    s.put(make_pair(i, i+1));
+  }
+  EXPECT_EQ(s.size(), 8);
+  EXPECT_TRUE(ii2.batches.empty());
+
+  // Crossing capacity evicts down to the low watermark in one write
+  s.put(make_pair(8, 9));
+  EXPECT_EQ(s.size(), 4);
+  EXPECT_EQ(ii2.batches, vector<size_t>({5}));
+  for (int i = 0; i < 9; ++i) {
+    EXPECT_EQ(s.contains(i), i > 4);
+    EXPECT_EQ(ii2.contains(i), i <= 4);
+  }
+
+  // And the cache refills to capacity before evicting again
+  for (int i = 9; i < 13; ++i) {
+    s.put(make_pair(i, i+1));
+  }
+  EXPECT_EQ(s.size(), 8);
+  EXPECT_EQ(ii2.batches.size(), 1);
+  s.put(make_pair(13, 14));
+  EXPECT_EQ(s.size(), 4);
+  EXPECT_EQ(ii2.batches, vector<size_t>({5, 5}));
+
+  // Clearing writes everything back at once
+  s.clear();
+  EXPECT_TRUE(s.empty());
+  EXPECT_EQ(ii2.batches, vector<size_t>({5, 5, 4}));
+  for (int i = 0; i < 14; ++i) {
+    EXPECT_EQ(ii2.get(i), i+1);
+  }
+
+  // Without a watermark, at most one key is evicted per put
+  s.watermark(8);
+  for (int i = 0; i < 9; ++i) {
+    s.put(make_pair(i+20, i));
+  }
+  EXPECT_EQ(s.size(), 8);
+  EXPECT_EQ(ii2.batches.back(), 1);
+}
+
+// Weigher tests
+TEST(cache, weighted) {
+  typedef Store<int, string> S;
+  S is1;
+  S is2;
+  Cache<S, S, Lru<S>, Fetch<S>, WriteThrough<S>, AdmitAll<S>, Sizeof<S>> s(&is1, &is2, 4096);
+  const auto entry = sizeof(S::value_type);
+
+  // Values of mixed sizes are kept within a byte budget
+  for (int i = 0; i < 64; ++i) {
+    s.put(make_pair(i, string(i % 8 == 0 ? 1024 : 16, 'x')));
+    EXPECT_LE(s.weight(), 4096);
+  }
+  EXPECT_TRUE(s.contains(63));
+  EXPECT_GT(s.size(), 4096 / (entry + 1024));
+
+  // Replacing a value replaces its weight, though the store keeps existing
+  // values on insert
+  s.put(make_pair(63, string(1024, 'y')));
+  EXPECT_EQ(s.get(63), string(1024, 'y'));
+  s.put(make_pair(63, string()));
+  EXPECT_EQ(s.get(63), string());
+  size_t weight = 0;
+  for (const auto& v : is1) {
+    weight += entry + v.second.size();
+  }
+  EXPECT_EQ(s.weight(), weight);
+
+  // Shrinking the budget evicts down to it, and a value larger than the whole
+  // budget is not kept
+  s.capacity(1024);
+  EXPECT_LE(s.weight(), 1024);
+  s.put(make_pair(100, string(2048, 'z')));
+  EXPECT_FALSE(s.contains(100));
+  EXPECT_EQ(s.get(100), string(2048, 'z'));
+
+  s.clear();
+  EXPECT_EQ(s.weight(), 0);
+  EXPECT_TRUE(s.empty());
+}
+
+// A backing store which may be shared with a writer thread, and whose batched
+// writes are slow, counted, and replace existing values. While closed, batched
+// writes wait for it to open, for up to two seconds.
+struct SlowWrites : Store<int, int> {
+  mutex m;
+  size_t batches = 0;
+  atomic<bool> open{true};
+  bool contains(int k) {
+    lock_guard<mutex> lock(m);
+    return Store<int, int>::contains(k);
+  }
+  int get(int k) {
+    lock_guard<mutex> lock(m);
+    return Store<int, int>::get(k);
+  }
+  template <typename VItr>
+  void multi_put(VItr begin, VItr end) {
+    for (int i = 0; i < 2000 && !open; ++i) {
+      this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    this_thread::sleep_for(chrono::milliseconds(5));
+    lock_guard<mutex> lock(m);
+    ++batches;
+    for (; begin != end; ++begin) {
+      Store<int, int>::erase(begin->first);
+      Store<int, int>::put(*begin);
+    }
+  }
+};
+// A backing store which can't be written
+struct FailingWrites : Store<int, int> {
+  void put(const value_type&) {
+    throw runtime_error("unavailable");
+  }
+};
+TEST(cache, write_behind) {
+  // Repeated writes to a key are coalesced, and written in batches
+  SlowWrites b;
+  WriteBehind<SlowWrites> w;
+  for (int i = 0; i < 1000; ++i) {
+    w.modify(b, make_pair(i % 10, i));
+  }
+  w.sync();
+  for (int k = 0; k < 10; ++k) {
+    EXPECT_EQ(b.get(k), 990 + k);
+  }
+  EXPECT_LT(w.writes(), 1000);
+  EXPECT_EQ(w.batches(), b.batches);
+  EXPECT_LT(b.batches, 1000);
+
+  // No more than limit keys wait at once
+  SlowWrites b2;
+  WriteBehind<SlowWrites> w2(4);
+  vector<pair<int, int>> vs;
+  for (int i = 0; i < 100; ++i) {
+    vs.push_back(make_pair(i, i));
+  }
+  w2.modify(b2, vs.begin(), vs.end());
+  w2.sync();
+  EXPECT_EQ(w2.writes(), 100);
+  EXPECT_GE(w2.batches(), 25);
+
+  // As a cache policy, evictions don't wait for the backing store, and misses
+  // on keys which are still waiting are served from the queue
+  SlowWrites b3;
+  b3.open = false;
+  {
+    Store<int, int> p;
+    Cache<Store<int, int>, SlowWrites, Lru<Store<int, int>>, Fetch<SlowWrites>, WriteBehind<SlowWrites>> s(&p, &b3, 4);
+    for (int i = 0; i < 100; ++i) {
+      s.put(make_pair(i, i+1));
+      EXPECT_EQ(s.get(i/2), i/2+1);
+    }
+    s.clear();
+    for (int i = 0; i < 100; ++i) {
+      EXPECT_EQ(s.get(i), i+1);
+    }
+    EXPECT_EQ(b3.size(), 0);
+    b3.open = true;
+  }
+
+  // The writer thread writes whatever is waiting before it stops
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(b3.get(i), i+1);
+  }
+
+  // Errors on the writer thread are recorded rather than thrown
+  FailingWrites b4;
+  WriteBehind<FailingWrites> w4;
+  w4.modify(b4, make_pair(1, 1));
+  w4.sync();
+  w4.modify(b4, make_pair(2, 2));
+  w4.sync();
+  EXPECT_EQ(w4.writes(), 0);
+  EXPECT_EQ(w4.errors(), 2);
+  EXPECT_THROW(rethrow_exception(w4.error()), runtime_error);
+}
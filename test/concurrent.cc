@@ -0,0 +1,227 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "include/concurrent.h"
+#include "include/flat.h"
+#include "include/sharded.h"
+#include "include/store.h"
+#include "test/interface.h"
+
+using namespace binder;
+
+// Basic tests
+TEST(concurrent_cache, basic) {
+  Store<char, int> b;
+  ConcurrentCache<Store<char, int>, decltype(b)> s(&b, 1024, 4);
+  basic(s);
+  iterators(s);
+}
+TEST(concurrent_cache, batched) {
+  Store<char, int> b;
+  ConcurrentCache<Store<char, int>, decltype(b)> s(&b, 1024, 4);
+  batched(s);
+}
+
+// Capacity test
+TEST(concurrent_cache, capacity) {
+  Store<int, int> b;
+  ConcurrentCache<Store<int, int>, decltype(b)> s(&b, 64, 4);
+  EXPECT_EQ(s.shards(), 4);
+  for (int i = 0; i < 1000; ++i) {
+    s.put(make_pair(i, i+1));
+    EXPECT_LE(s.size(), 64);
+  }
+  EXPECT_EQ(b.size(), 1000);
+  EXPECT_GT(s.size(), 48);
+
+  // Misses are fetched from the backing store, in order
+  vector<int> ks;
+  for (int i = 1010; i >= 0; i -= 7) {
+    ks.push_back(i);
+  }
+  vector<int> vs;
+  s.multi_get(ks.begin(), ks.end(), back_inserter(vs));
+  for (size_t i = 0; i < ks.size(); ++i) {
+    EXPECT_EQ(vs[i], ks[i] < 1000 ? ks[i]+1 : 0);
+  }
+  EXPECT_LE(s.size(), 64);
+
+  s.capacity(8);
+  EXPECT_LE(s.size(), 8);
+  EXPECT_EQ(s.get(500), 501);
+  s.clear();
+  EXPECT_TRUE(s.empty());
+  EXPECT_EQ(s.get(500), 501);
+}
+
+// Write back test
+TEST(concurrent_cache, write_back) {
+  Store<int, int> b;
+  ConcurrentCache<Store<int, int>, decltype(b), Lru<Store<int, int>>,
+    Fetch<decltype(b)>, WriteBack<decltype(b)>> s(&b, 16, 4);
+  for (int i = 0; i < 100; ++i) {
+    s.put(make_pair(i, i+1));
+  }
+  EXPECT_LT(b.size(), 100);
+  s.clear();
+  EXPECT_EQ(b.size(), 100);
+}
+
+// Concurrent readers and writers test
+TEST(concurrent_cache, concurrent) {
+  ShardedStore<int, int> b(8);
+  ConcurrentCache<Store<int, int>, decltype(b)> s(&b, 512, 8);
+  const int n = 8;
+  const int m = 1000;
+
+  std::vector<std::thread> ts;
+  for (int t = 0; t < n; ++t) {
+    ts.emplace_back([&s, t]{
+      for (int i = 0; i < m; ++i) {
+        s.put(make_pair(t*m + i, i));
+        EXPECT_EQ(s.get(t*m + i), i);
+        EXPECT_EQ(s.get(t*m + i/2), i/2);
+      }
+      vector<int> ks;
+      for (int i = 0; i < m; i += 2) {
+        ks.push_back(t*m + i);
+      }
+      vector<int> gs;
+      s.multi_get(ks.begin(), ks.end(), back_inserter(gs));
+      for (size_t i = 0; i < ks.size(); ++i) {
+        EXPECT_EQ(gs[i], 2*(int)i);
+      }
+      s.multi_erase(ks.begin(), ks.end());
+    });
+  }
+  for (auto& t : ts) {
+    t.join();
+  }
+
+  EXPECT_EQ(b.size(), n*m);
+  EXPECT_LE(s.size(), 512);
+  for (const auto& v : s) {
+    EXPECT_EQ(v.first % 2, 1);
+  }
+}
+
+// A backing store whose reads are slow, and counted
+struct SlowReads : Store<int, int> {
+  atomic<int> reads{0};
+  bool contains(int k) {
+    ++reads;
+    this_thread::sleep_for(chrono::milliseconds(100));
+    return Store<int, int>::contains(k);
+  }
+};
+
+// Miss coalescing test
+TEST(concurrent_cache, coalesce) {
+  SlowReads b;
+  b.put(make_pair(1, 2));
+  ConcurrentCache<Store<int, int>, SlowReads, Lru<Store<int, int>>, Fetch<SlowReads>> s(&b, 16, 4);
+
+  // Concurrent misses on one key fetch it once
+  const int n = 8;
+  std::vector<std::thread> ts;
+  for (int t = 0; t < n; ++t) {
+    ts.emplace_back([&s]{
+      EXPECT_EQ(s.get(1), 2);
+    });
+  }
+  for (auto& t : ts) {
+    t.join();
+  }
+  EXPECT_EQ(b.reads + s.coalesced(), n);
+  EXPECT_GT(s.coalesced(), 0);
+
+  // Later gets hit
+  EXPECT_EQ(s.get(1), 2);
+  EXPECT_EQ(b.reads + s.coalesced(), n);
+
+  // Misses on absent keys are coalesced too, and not cached
+  ts.clear();
+  for (int t = 0; t < n; ++t) {
+    ts.emplace_back([&s]{
+      EXPECT_EQ(s.get(3), 0);
+    });
+  }
+  for (auto& t : ts) {
+    t.join();
+  }
+  EXPECT_EQ(b.reads + s.coalesced(), 2*n);
+  EXPECT_FALSE(s.contains(3));
+}
+
+// A backing store whose reads are counted
+struct CountedReads : Store<int, int> {
+  atomic<int> reads{0};
+  bool contains(int k) {
+    ++reads;
+    return Store<int, int>::contains(k);
+  }
+};
+
+// Negative read policy test
+TEST(concurrent_cache, negative) {
+  CountedReads b;
+  b.put(make_pair(1, 2));
+  ConcurrentCache<Store<int, int>, CountedReads, Lru<Store<int, int>>, Negative<CountedReads>> s(&b, 16, 4);
+
+  // Each shard's read policy remembers the keys it found to be missing
+  EXPECT_EQ(s.get(3), 0);
+  EXPECT_EQ(s.get(3), 0);
+  EXPECT_EQ(b.reads, 1);
+  vector<int> ks = {1, 3, 4, 5, 6};
+  vector<int> vs;
+  s.multi_get(ks.begin(), ks.end(), back_inserter(vs));
+  EXPECT_EQ(vs, vector<int>({2, 0, 0, 0, 0}));
+  EXPECT_EQ(b.reads, 5);
+  vs.clear();
+  s.multi_get(ks.begin() + 1, ks.end(), back_inserter(vs));
+  EXPECT_EQ(vs, vector<int>({0, 0, 0, 0}));
+  EXPECT_EQ(b.reads, 5);
+
+  // Putting a key forgets that it was missing
+  s.put(make_pair(3, 4));
+  s.erase(3);
+  EXPECT_EQ(s.get(3), 4);
+  EXPECT_EQ(b.reads, 6);
+}
+
+// A write back policy which is slow to take a put
+struct SlowModify : WriteBack<Store<int, int>> {
+  void modify(Store<int, int>& s, const pair<const int, int>& v) {
+    this_thread::sleep_for(chrono::milliseconds(100));
+    WriteBack<Store<int, int>>::modify(s, v);
+  }
+};
+
+// Stale fill test
+TEST(concurrent_cache, stale) {
+  // A get which misses while a put holds the shard serves the put value once
+  // it has landed, rather than overwriting it with the value in s2
+  Store<int, int> b;
+  b.put(make_pair(1, 2));
+  ConcurrentCache<FlatStore<int, int>, Store<int, int>, Lru<FlatStore<int, int>>, Fetch<Store<int, int>>, SlowModify> s(&b, 16, 1);
+  thread t([&s]{ s.put(make_pair(1, 99)); });
+  this_thread::sleep_for(chrono::milliseconds(20));
+  EXPECT_EQ(s.get(1), 99);
+  t.join();
+  EXPECT_EQ(s.get(1), 99);
+
+  // Likewise for a batched get, which fetches only the keys still missing
+  b.put(make_pair(3, 4));
+  s.erase(1);
+  b.put(make_pair(1, 2));
+  t = thread([&s]{ s.put(make_pair(1, 98)); });
+  this_thread::sleep_for(chrono::milliseconds(20));
+  vector<int> ks = {1, 3};
+  vector<int> vs;
+  s.multi_get(ks.begin(), ks.end(), back_inserter(vs));
+  EXPECT_EQ(vs, vector<int>({98, 4}));
+  t.join();
+  EXPECT_EQ(s.get(1), 98);
+}
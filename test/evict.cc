@@ -0,0 +1,260 @@
+#include <vector>
+#include "gtest/gtest.h"
+#include "include/cache.h"
+#include "include/evict.h"
+#include "include/store.h"
+#include "test/interface.h"
+
+using namespace binder;
+
+// Touches and evicts keys from a trace, returning the evicted keys in order.
+// As in Cache, policies are asked to evict once a new key exceeds capacity.
+template <typename E>
+vector<int> replay(E& e, const vector<int>& trace, size_t capacity) {
+  vector<int> res;
+  set<int> resident;
+  for (auto k : trace) {
+    e.touch(k);
+    resident.insert(k);
+    if (resident.size() > capacity) {
+      const auto v = e.evict();
+      e.erase(v);
+      resident.erase(v);
+      res.push_back(v);
+    }
+  }
+  return res;
+}
+
+// Replays a trace as above, returning the fraction of touches from index
+// begin onwards which hit a resident key
+template <typename E>
+double hit_ratio(E& e, const vector<int>& trace, size_t capacity, size_t begin) {
+  size_t hits = 0;
+  set<int> resident;
+  for (size_t i = 0; i < trace.size(); ++i) {
+    const auto k = trace[i];
+    if (resident.count(k) != 0) {
+      hits += i >= begin;
+    }
+    e.touch(k);
+    resident.insert(k);
+    if (resident.size() > capacity) {
+      const auto v = e.evict();
+      e.erase(v);
+      resident.erase(v);
+    }
+  }
+  return (double)hits / (trace.size() - begin);
+}
+
+// A hot set of 40 keys mixed with one-off cold keys, then a scan of 1000 keys
+// which are never seen again, then the hot set alone. Returns the trace and
+// the index at which the hot set resumes.
+pair<vector<int>, size_t> scan_trace() {
+  vector<int> trace;
+  int cold = 1000;
+  for (int r = 0; r < 50; ++r) {
+    for (int k = 0; k < 40; ++k) {
+      trace.push_back(k);
+      if (k % 2 == 0) {
+        trace.push_back(cold++);
+      }
+    }
+  }
+  for (int i = 0; i < 1000; ++i) {
+    trace.push_back(cold++);
+  }
+  const auto begin = trace.size();
+  for (int r = 0; r < 5; ++r) {
+    for (int k = 0; k < 40; ++k) {
+      trace.push_back(k);
+    }
+  }
+  return make_pair(trace, begin);
+}
+
+// Lru policy test
+TEST(evict, lru) {
+  Lru<Store<int, int>> e;
+  const auto res = replay(e, {1, 2, 3, 1, 4, 5, 2, 1, 6}, 3);
+  EXPECT_EQ(res, vector<int>({2, 3, 1, 4, 5}));
+}
+
+// HashLru policy test
+TEST(evict, hash_lru) {
+  HashLru<Store<int, int>> e;
+  const auto res = replay(e, {1, 2, 3, 1, 4, 5, 2, 1, 6}, 3);
+  EXPECT_EQ(res, vector<int>({2, 3, 1, 4, 5}));
+
+  // Agrees with Lru over a longer trace, which recycles pooled nodes
+  vector<int> trace;
+  for (int i = 0; i < 10000; ++i) {
+    trace.push_back((i * 7919) % 101 + (i % 3 == 0 ? 0 : i % 17));
+  }
+  Lru<Store<int, int>> l;
+  HashLru<Store<int, int>> h;
+  h.reserve(32);
+  EXPECT_EQ(replay(h, trace, 32), replay(l, trace, 32));
+
+  // Erasing a key which isn't present does nothing
+  h.erase(-1);
+
+  // As a cache policy
+  Store<char, int> ci1;
+  Store<char, int> ci2;
+  Cache<decltype(ci1), decltype(ci2), HashLru<decltype(ci1)>> s(&ci1, &ci2, 26);
+  basic(s);
+}
+
+// Arc policy test
+TEST(evict, arc) {
+  // Keys seen twice outlive keys seen once
+  Arc<Store<int, int>> e;
+  auto res = replay(e, {1, 2, 1, 3, 4, 5}, 3);
+  EXPECT_EQ(res, vector<int>({2, 3}));
+
+  // A scan doesn't flush the hot set, where it does for Lru
+  const auto t = scan_trace();
+  Lru<Store<int, int>> l;
+  Arc<Store<int, int>> a;
+  EXPECT_LT(hit_ratio(l, t.first, 100, t.second), 0.85);
+  EXPECT_GT(hit_ratio(a, t.first, 100, t.second), 0.95);
+
+  // Ghosts are bounded by twice the capacity
+  vector<int> trace;
+  for (int i = 0; i < 10000; ++i) {
+    trace.push_back((i * 7919) % 1009);
+  }
+  Arc<Store<int, int>> g;
+  replay(g, trace, 32);
+  EXPECT_LE(g.ghosts(), 32);
+
+  // As a cache policy
+  Store<char, int> ci1;
+  Store<char, int> ci2;
+  Cache<decltype(ci1), decltype(ci2), Arc<decltype(ci1)>> s(&ci1, &ci2, 26);
+  basic(s);
+}
+
+// TwoQ policy test
+TEST(evict, two_q) {
+  // Keys seen again after eviction from a1in outlive keys seen once
+  TwoQ<Store<int, int>> e;
+  auto res = replay(e, {1, 2, 3, 4, 5, 1, 6, 7, 8, 9}, 4);
+  EXPECT_EQ(res, vector<int>({1, 2, 3, 4, 5, 6}));
+
+  // A scan doesn't flush the hot set, where it does for Lru
+  const auto t = scan_trace();
+  Lru<Store<int, int>> l;
+  TwoQ<Store<int, int>> q;
+  EXPECT_LT(hit_ratio(l, t.first, 100, t.second), 0.85);
+  EXPECT_GT(hit_ratio(q, t.first, 100, t.second), 0.95);
+
+  // As a cache policy
+  Store<char, int> ci1;
+  Store<char, int> ci2;
+  Cache<decltype(ci1), decltype(ci2), TwoQ<decltype(ci1)>> s(&ci1, &ci2, 26);
+  basic(s);
+}
+
+// Clock policy test
+TEST(evict, clock) {
+  // Referenced keys get a second chance
+  Clock<Store<int, int>> e;
+  const auto res = replay(e, {1, 2, 3, 1, 4, 5, 2, 1, 6}, 3);
+  EXPECT_EQ(res, vector<int>({2, 3, 4, 5}));
+
+  // Slots are recycled, and hit about as often as Lru
+  vector<int> trace;
+  for (int i = 0; i < 10000; ++i) {
+    trace.push_back((i * 7919) % 101 + (i % 3 == 0 ? 0 : i % 17));
+  }
+  Lru<Store<int, int>> l;
+  Clock<Store<int, int>> c;
+  c.reserve(32);
+  EXPECT_GT(hit_ratio(c, trace, 32, 0), 0.8 * hit_ratio(l, trace, 32, 0));
+
+  // Peeking selects the key evict() would without clearing reference bits
+  Clock<Store<int, int>> k;
+  replay(k, {1, 2, 3, 1, 2}, 3);
+  EXPECT_EQ(k.peek(), 1);
+  k.touch(3);
+  EXPECT_EQ(k.peek(), 1);
+  EXPECT_EQ(k.evict(), 1);
+  k.erase(1);
+  EXPECT_EQ(k.peek(), 2);
+
+  // As a cache policy
+  Store<char, int> ci1;
+  Store<char, int> ci2;
+  Cache<decltype(ci1), decltype(ci2), Clock<decltype(ci1)>> s(&ci1, &ci2, 26);
+  basic(s);
+}
+
+// Sieve policy test
+TEST(evict, sieve) {
+  // Visited keys stay in place while the hand passes
+  Sieve<Store<int, int>> e;
+  const auto res = replay(e, {1, 2, 3, 1, 4, 5, 2, 1, 6}, 3);
+  EXPECT_EQ(res, vector<int>({2, 3, 4, 5}));
+
+  // A scan doesn't flush the hot set
+  const auto t = scan_trace();
+  Sieve<Store<int, int>> v;
+  EXPECT_GT(hit_ratio(v, t.first, 100, t.second), 0.95);
+
+  // As a cache policy
+  Store<char, int> ci1;
+  Store<char, int> ci2;
+  Cache<decltype(ci1), decltype(ci2), Sieve<decltype(ci1)>> s(&ci1, &ci2, 26);
+  basic(s);
+}
+
+// Gdsf policy test
+TEST(evict, gdsf) {
+  // Large keys go before small ones, and rarely touched keys before often
+  // touched ones
+  Gdsf<Store<int, int>> e;
+  e.touch(1, 10);
+  e.touch(2, 1);
+  e.touch(3, 1);
+  e.touch(2);
+  EXPECT_EQ(e.evict(), 1);
+  e.erase(1);
+
+  // Priorities age, so that new keys can displace old ones
+  e.touch(4, 1);
+  EXPECT_EQ(e.evict(), 3);
+  e.erase(3);
+  e.touch(5, 1);
+  EXPECT_EQ(e.evict(), 4);
+  e.erase(4);
+
+  // Copies are independent
+  auto c = e;
+  e.erase(2);
+  e.erase(5);
+  EXPECT_EQ(c.evict(), 2);
+  c.erase(2);
+  EXPECT_EQ(c.evict(), 5);
+
+  // As a cache policy
+  typedef Store<int, string> S;
+  S is1;
+  S is2;
+  Cache<S, S, Gdsf<S>, Fetch<S>, WriteThrough<S>, AdmitAll<S>, Sizeof<S>> s(&is1, &is2, 4096);
+  for (int i = 0; i < 64; ++i) {
+    s.put(make_pair(i, string(i % 8 == 0 ? 1024 : 16, 'x')));
+    s.get(i % 8 == 0 ? i : i / 2);
+  }
+  for (int i = 0; i < 64; i += 8) {
+    EXPECT_FALSE(s.contains(i));
+  }
+  EXPECT_LE(s.weight(), 4096);
+
+  Store<char, int> ci1;
+  Store<char, int> ci2;
+  Cache<decltype(ci1), decltype(ci2), Gdsf<decltype(ci1)>> s2(&ci1, &ci2, 26);
+  basic(s2);
+}
@@ -0,0 +1,83 @@
+#include <string>
+#include "gtest/gtest.h"
+#include "include/flat.h"
+#include "test/interface.h"
+
+using namespace binder;
+
+// Basic test
+TEST(flat_store, basic) {
+  FlatStore<char, int> s;
+  basic(s);
+}
+
+// put() overwrites existing keys
+TEST(flat_store, overwrite) {
+  FlatStore<int, std::string> s;
+  s.put(make_pair(1, std::string("a")));
+  s.put(make_pair(1, std::string("b")));
+  EXPECT_EQ(s.size(), 1);
+  EXPECT_EQ(s.get(1), "b");
+}
+
+// Growth and tombstone reuse test
+TEST(flat_store, churn) {
+  FlatStore<int, int> s;
+  for (int i = 0; i < 10000; ++i) {
+    s.put(make_pair(i, i));
+  }
+  for (int i = 0; i < 10000; i += 2) {
+    s.erase(i);
+  }
+  EXPECT_EQ(s.size(), 5000);
+  for (int i = 0; i < 10000; ++i) {
+    EXPECT_EQ(s.contains(i), i % 2 == 1);
+  }
+
+  // Alternating erases and puts shouldn't lose anything
+  for (int i = 0; i < 100000; ++i) {
+    s.erase(i % 10000);
+    s.put(make_pair(i % 10000 + 10000, i));
+  }
+  size_t n = 0;
+  for (const auto& v : s) {
+    EXPECT_EQ(s.get(v.first), v.second);
+    ++n;
+  }
+  EXPECT_EQ(n, s.size());
+}
+
+// Copy test
+TEST(flat_store, copy) {
+  FlatStore<int, std::string> s1;
+  for (int i = 0; i < 100; ++i) {
+    s1.put(make_pair(i, std::to_string(i)));
+  }
+  auto s2 = s1;
+  EXPECT_EQ(s1, s2);
+  s2.erase(0);
+  EXPECT_NE(s1, s2);
+  EXPECT_TRUE(s1.contains(0));
+
+  s1.clear();
+  EXPECT_TRUE(s1.empty());
+  EXPECT_EQ(s1.begin(), s1.end());
+  EXPECT_EQ(s2.size(), 99);
+}
+
+// Iterator test
+TEST(flat_store, iterator) {
+  FlatStore<int, int> s;
+  s.put(make_pair(1, 2));
+  auto i = s.begin();
+  EXPECT_NE(i, s.end());
+  i = s.end();
+  EXPECT_EQ(i, s.end());
+
+  // Iterators convert to const iterators, but not back
+  FlatStore<int, int>::const_iterator ci = s.begin();
+  EXPECT_EQ(ci->second, 2);
+  ci = i;
+  EXPECT_EQ(ci, s.cend());
+  EXPECT_FALSE((is_convertible<FlatStore<int, int>::const_iterator, FlatStore<int, int>::iterator>::value));
+}
@@ -0,0 +1,149 @@
+#include <random>
+#include <set>
+#include <vector>
+#include "gtest/gtest.h"
+#include "include/cache.h"
+#include "include/fused.h"
+#include "include/store.h"
+#include "test/interface.h"
+
+using namespace binder;
+
+// Basic test
+TEST(fused_cache, basic) {
+  Store<char, int> ci;
+  FusedCache<decltype(ci)> s(&ci, 26);
+  basic(s);
+  iterators(s);
+}
+
+// Batched test
+TEST(fused_cache, batched) {
+  Store<char, int> ci;
+  FusedCache<decltype(ci)> s(&ci, 26);
+  batched(s);
+}
+
+// Replays the same gets and puts through a FusedCache and a Cache with the
+// same evict policy, which should hold the same keys throughout
+template <typename E>
+void same_as_cache() {
+  typedef Store<int, int> S;
+  S b1;
+  S b2;
+  S p;
+  FusedCache<S, E, Fetch<S>, WriteThrough<S>> f(&b1, 32);
+  Cache<S, S, E> c(&p, &b2, 32);
+  for (int i = 0; i < 128; ++i) {
+    b1.put(make_pair(i, i+1));
+    b2.put(make_pair(i, i+1));
+  }
+
+  mt19937 gen(7);
+  uniform_int_distribution<int> u(0, 127);
+  for (int i = 0; i < 4096; ++i) {
+    const auto k = u(gen) % (i % 3 == 0 ? 128 : 48);
+    EXPECT_EQ(f.get(k), k+1);
+    c.get(k);
+    if (i % 64 == 0) {
+      f.put(make_pair(200+i, 0));
+      c.put(make_pair(200+i, 0));
+    }
+    ASSERT_EQ(f.size(), c.size());
+    for (const auto& v : c) {
+      ASSERT_TRUE(f.contains(v.first)) << i;
+    }
+  }
+}
+TEST(fused_cache, evict) {
+  same_as_cache<Lru<Store<int, int>>>();
+  same_as_cache<HashLru<Store<int, int>>>();
+  same_as_cache<Clock<Store<int, int>>>();
+  same_as_cache<Sieve<Store<int, int>>>();
+}
+
+// Write policy tests
+struct FusedPuts : Store<int, int> {
+  vector<size_t> batches;
+  template <typename VItr>
+  void multi_put(VItr begin, VItr end) {
+    batches.push_back(distance(begin, end));
+    for (; begin != end; ++begin) {
+      put(*begin);
+    }
+  }
+};
+TEST(fused_cache, write_back) {
+  FusedPuts ii;
+  FusedCache<FusedPuts> s(&ii, 4);
+  s.watermark(2);
+
+  // Dirty values only reach the backing store when they are evicted, in one
+  // batch, and clean ones are never written
+  ii.put(make_pair(0, 1));
+  EXPECT_EQ(s.get(0), 1);
+  for (int i = 1; i < 4; ++i) {
+    s.put(make_pair(i, i+1));
+  }
+  EXPECT_EQ(s.size(), 4);
+  EXPECT_FALSE(ii.contains(1));
+  s.put(make_pair(4, 5));
+  EXPECT_EQ(s.size(), 2);
+  EXPECT_EQ(ii.batches, vector<size_t>({2}));
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(ii.contains(i), i <= 2);
+  }
+
+  // Erasing writes back a dirty value
+  s.erase(3);
+  EXPECT_TRUE(ii.contains(3));
+  EXPECT_FALSE(s.contains(3));
+  s.clear();
+  EXPECT_TRUE(s.empty());
+  EXPECT_EQ(ii.get(4), 5);
+}
+TEST(fused_cache, write_through) {
+  Store<int, int> ii;
+  FusedCache<decltype(ii), Sieve<decltype(ii)>, Fetch<decltype(ii)>, WriteThrough<decltype(ii)>> s(&ii, 2);
+  s.put(make_pair(1, 1));
+  EXPECT_TRUE(ii.contains(1));
+  EXPECT_TRUE(s.contains(1));
+}
+
+// Copy test
+TEST(fused_cache, copy) {
+  Store<int, int> ii;
+  FusedCache<decltype(ii), Clock<decltype(ii)>> s1(&ii, 8);
+  for (int i = 0; i < 12; ++i) {
+    s1.put(make_pair(i, i));
+    s1.get(i / 2);
+  }
+  auto s2 = s1;
+  EXPECT_EQ(s1, s2);
+  EXPECT_TRUE(equal(s1.begin(), s1.end(), s2.begin()));
+
+  // Copies evict in the same order, and write back independently
+  for (int i = 12; i < 20; ++i) {
+    s1.put(make_pair(i, i));
+    s2.put(make_pair(i, i));
+    EXPECT_EQ(s1, s2);
+  }
+  s2.clear();
+  EXPECT_EQ(s1.size(), 8);
+  EXPECT_NE(s1, s2);
+  EXPECT_EQ(ii.size(), 20);
+
+  s2 = move(s1);
+  EXPECT_EQ(s2.size(), 8);
+  EXPECT_TRUE(s1.empty());
+}
+
+// Missing store test
+TEST(fused_cache, missing_store) {
+  FusedCache<Store<int, int>> s;
+  EXPECT_EQ(s.begin(), s.end());
+  EXPECT_EQ(s.get(1), int());
+  s.put(make_pair(1, 1));
+  EXPECT_FALSE(s.contains(1));
+  s.clear();
+}
@@ -1,7 +1,11 @@
 #ifndef BINDER_TEST_INTERFACE_TEST_H
 #define BINDER_TEST_INTERFACE_TEST_H
 
+#include <iterator>
 #include <set>
+#include <type_traits>
+#include <vector>
+#include "include/multi.h"
 using namespace std;
 
 template <typename S>
@@ -36,4 +40,58 @@ void basic(S& s) {
   }
 }
 
+template <typename S>
+void batched(S& s) {
+  s.clear();
+  EXPECT_EQ(s.size(), 0);
+
+  vector<pair<char, int>> vs;
+  vector<char> ks;
+  for (size_t i = 0; i < 26; i += 2) {
+    const auto k = (char)((int)'a' + i);
+    vs.push_back(make_pair(k, (int)i+1));
+    ks.push_back(k);
+    ks.push_back((char)((int)'a' + i + 1));
+  }
+  binder::multi_put(s, vs.begin(), vs.end());
+  EXPECT_EQ(s.size(), 13);
+
+  // Every other key is present
+  vector<bool> cs;
+  binder::multi_contains(s, ks.begin(), ks.end(), back_inserter(cs));
+  vector<int> gs;
+  binder::multi_get(s, ks.begin(), ks.end(), back_inserter(gs));
+  EXPECT_EQ(cs.size(), 26);
+  EXPECT_EQ(gs.size(), 26);
+  for (size_t i = 0; i < 26; ++i) {
+    EXPECT_EQ(cs[i], i % 2 == 0);
+    EXPECT_EQ(gs[i], i % 2 == 0 ? (int)i+1 : int());
+  }
+
+  // Erasing a mix of present and absent keys
+  binder::multi_erase(s, ks.begin(), ks.begin() + 4);
+  EXPECT_EQ(s.size(), 11);
+  EXPECT_FALSE(s.contains('a'));
+  EXPECT_FALSE(s.contains('c'));
+  EXPECT_TRUE(s.contains('e'));
+}
+
+// Assigns iterators of a store holding at least one entry, and converts them
+// to const iterators
+template <typename S>
+void iterators(S& s) {
+  auto i = s.begin();
+  EXPECT_NE(i, s.end());
+  i = s.end();
+  EXPECT_EQ(i, s.end());
+
+  typedef typename iterator_traits<typename S::const_iterator>::reference cref;
+  static_assert(is_const<typename remove_reference<cref>::type>::value,
+      "const_iterator must not yield mutable references");
+  typename S::const_iterator ci = s.begin();
+  EXPECT_NE(ci, s.cend());
+  ci = i;
+  EXPECT_EQ(ci, s.cend());
+}
+
 #endif
@@ -0,0 +1,205 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <string>
+#include <thread>
+#include "gtest/gtest.h"
+#include "include/cache.h"
+#include "include/log.h"
+#include "include/store.h"
+#include "test/interface.h"
+
+using namespace binder;
+
+static string log_path(const string& name) {
+  const auto path = ::testing::TempDir() + "binder_log_" + name;
+  remove(path.c_str());
+  return path;
+}
+
+static size_t disk_size(const string& path) {
+  ifstream f(path, ios::binary | ios::ate);
+  return f.tellg();
+}
+
+// Basic test
+TEST(log_store, basic) {
+  LogStore<char, int> s(log_path("basic"));
+  basic(s);
+  iterators(s);
+}
+
+// Batched test
+TEST(log_store, batched) {
+  LogStore<char, int> s(log_path("batched"));
+  batched(s);
+}
+
+// Open test
+TEST(log_store, open) {
+  // Default construction is closed, and operations do nothing
+  LogStore<int, double> s;
+  EXPECT_FALSE(s.is_open());
+  s.put(make_pair(1, 1.0));
+  EXPECT_FALSE(s.contains(1));
+  EXPECT_EQ(s.begin(), s.end());
+  s.flush();
+  s.compact();
+  s.close();
+
+  // Moves take the file
+  s.open(log_path("open"));
+  EXPECT_TRUE(s.is_open());
+  s.put(make_pair(1, 1.0));
+  auto s1 = move(s);
+  EXPECT_FALSE(s.is_open());
+  EXPECT_EQ(s1.get(1), 1.0);
+
+  // Stores in different files compare equal if they hold the same values
+  LogStore<int, double> s2(log_path("open2"));
+  EXPECT_NE(s1, s2);
+  s2.put(make_pair(1, 2.0));
+  EXPECT_NE(s1, s2);
+  s2.put(make_pair(1, 1.0));
+  EXPECT_EQ(s1, s2);
+}
+
+// Persistence test
+TEST(log_store, persistence) {
+  const auto path = log_path("persistence");
+  {
+    LogStore<string, string, Binary<string, string>> s(path);
+    for (int i = 0; i < 100; ++i) {
+      s.put(make_pair(to_string(i), string(i, 'x')));
+    }
+    s.put(make_pair(string("7"), string("seven")));
+    s.erase("8");
+  }
+  {
+    LogStore<string, string, Binary<string, string>> s(path);
+    EXPECT_EQ(s.size(), 99);
+    EXPECT_EQ(s.get("7"), "seven");
+    EXPECT_FALSE(s.contains("8"));
+    EXPECT_EQ(s.get("99"), string(99, 'x'));
+  }
+
+  // A record cut short by a crash is dropped
+  const auto size = disk_size(path);
+  {
+    ofstream f(path, ios::binary | ios::app);
+    f.write("\x05\x00\x00\x00\xff", 5);
+  }
+  LogStore<string, string, Binary<string, string>> s(path);
+  EXPECT_EQ(s.size(), 99);
+  EXPECT_EQ(disk_size(path), size);
+  s.put(make_pair(string("8"), string("eight")));
+  s.close();
+  s.open(path);
+  EXPECT_EQ(s.get("8"), "eight");
+}
+
+// Sync policy test
+TEST(log_store, group) {
+  const auto path = log_path("group");
+  LogStore<int, int> s(path, LogSync::GROUP);
+  s.set_group_size(1024, chrono::seconds(10));
+
+  // Records are buffered until there are enough to write together
+  s.put(make_pair(1, 1));
+  EXPECT_EQ(disk_size(path), 0);
+  EXPECT_EQ(s.get(1), 1);
+  for (int i = 0; i < 100; ++i) {
+    s.put(make_pair(i, i));
+  }
+  EXPECT_GT(disk_size(path), 0);
+  s.flush();
+  EXPECT_EQ(disk_size(path), s.file_size());
+
+  // Or once the first has waited long enough, even if nothing follows it
+  s.set_group_size(1 << 20, chrono::milliseconds(20));
+  s.put(make_pair(100, 100));
+  s.put(make_pair(101, 101));
+  EXPECT_LT(disk_size(path), s.file_size());
+  const auto deadline = chrono::steady_clock::now() + chrono::seconds(2);
+  while (disk_size(path) < s.file_size() && chrono::steady_clock::now() < deadline) {
+    this_thread::sleep_for(chrono::milliseconds(1));
+  }
+  EXPECT_EQ(disk_size(path), s.file_size());
+
+  // Each is written immediately
+  s.set_sync(LogSync::EACH);
+  s.put(make_pair(1000, 1000));
+  EXPECT_EQ(disk_size(path), s.file_size());
+  vector<pair<int, int>> vs = {{1001, 1}, {1002, 2}};
+  s.multi_put(vs.begin(), vs.end());
+  EXPECT_EQ(disk_size(path), s.file_size());
+
+  LogStore<int, int> r(path);
+  EXPECT_EQ(r.size(), 105);
+}
+
+// Compaction test
+TEST(log_store, compact) {
+  const auto path = log_path("compact");
+  LogStore<int, int> s(path);
+  s.set_compaction(1);
+  for (int n = 0; n < 10; ++n) {
+    for (int i = 0; i < 10000; ++i) {
+      s.put(make_pair(i, i * n));
+    }
+  }
+  for (int i = 0; i < 10000; i += 2) {
+    s.erase(i);
+  }
+  const auto size = s.file_size();
+
+  // Reads and writes continue while compacting
+  s.compact();
+  for (int i = 1; i < 10000; i += 2) {
+    ASSERT_EQ(s.get(i), i * 9);
+    s.put(make_pair(i, -i));
+  }
+  s.wait();
+  EXPECT_FALSE(s.is_compacting());
+  EXPECT_LT(s.file_size(), size / 5);
+  EXPECT_EQ(s.size(), 5000);
+  for (int i = 0; i < 10000; ++i) {
+    ASSERT_EQ(s.get(i), i % 2 == 0 ? 0 : -i);
+  }
+
+  // The compacted log replays to the same contents
+  map<int, int> before(s.begin(), s.end());
+  s.close();
+  s.open(path);
+  const map<int, int> after(s.begin(), s.end());
+  EXPECT_EQ(after, before);
+
+  // Compaction starts itself once enough of the log is dead, so that it
+  // stays within about twice the live records
+  s.set_compaction(0.5, 0);
+  const auto live = s.file_size();
+  for (int i = 0; i < 10000; ++i) {
+    s.put(make_pair(1, i));
+  }
+  s.wait();
+  EXPECT_LT(s.file_size(), 2 * live + 1024);
+  EXPECT_EQ(s.get(1), 9999);
+}
+
+// Cache test
+TEST(log_store, cache) {
+  const auto path = log_path("cache");
+  {
+    Store<int, int> p;
+    LogStore<int, int> b(path);
+    Cache<decltype(p), decltype(b)> c(&p, &b, 8);
+    for (int i = 0; i < 32; ++i) {
+      c.put(make_pair(i, i * i));
+    }
+    EXPECT_EQ(c.get(3), 9);
+  }
+  LogStore<int, int> b(path);
+  EXPECT_EQ(b.size(), 32);
+  EXPECT_EQ(b.get(31), 31 * 31);
+}
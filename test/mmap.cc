@@ -0,0 +1,220 @@
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include "gtest/gtest.h"
+#include "include/cache.h"
+#include "include/mmap.h"
+#include "include/store.h"
+#include "test/interface.h"
+
+using namespace binder;
+
+static string temp_path(const string& name) {
+  const auto path = ::testing::TempDir() + "binder_mmap_" + name;
+  remove(path.c_str());
+  return path;
+}
+
+// Basic test
+TEST(mmap_store, basic) {
+  MmapStore<char, int> s(temp_path("basic"));
+  basic(s);
+  iterators(s);
+}
+
+// Batched test
+TEST(mmap_store, batched) {
+  MmapStore<char, int> s(temp_path("batched"));
+  batched(s);
+}
+
+// Open test
+TEST(mmap_store, open) {
+  // Default construction is closed, and operations do nothing
+  MmapStore<int, double> s;
+  EXPECT_FALSE(s.is_open());
+  s.put(make_pair(1, 1.0));
+  EXPECT_FALSE(s.contains(1));
+  EXPECT_EQ(s.begin(), s.end());
+  s.checkpoint();
+  s.close();
+
+  // Files written with other sizes are left alone
+  const auto path = temp_path("open");
+  s.open(path);
+  EXPECT_TRUE(s.is_open());
+  s.close();
+  MmapStore<int, float> f(path);
+  EXPECT_FALSE(f.is_open());
+
+  // Moves take the mapping
+  s.open(path);
+  s.put(make_pair(1, 1.0));
+  auto s1 = move(s);
+  EXPECT_FALSE(s.is_open());
+  EXPECT_EQ(s1.get(1), 1.0);
+}
+
+// Persistence test
+TEST(mmap_store, persistence) {
+  const auto path = temp_path("persistence");
+  {
+    MmapStore<int, double> s(path);
+    for (int i = 0; i < 100; ++i) {
+      s.put(make_pair(i, i * 0.5));
+    }
+    s.erase(7);
+  }
+  MmapStore<int, double> s(path);
+  EXPECT_EQ(s.size(), 99);
+  EXPECT_FALSE(s.contains(7));
+  for (int i = 8; i < 100; ++i) {
+    EXPECT_EQ(s.get(i), i * 0.5);
+  }
+}
+
+// Growth test
+TEST(mmap_store, growth) {
+  const auto path = temp_path("growth");
+  MmapStore<int, int> s(path, 16);
+  for (int i = 0; i < 10000; ++i) {
+    s.put(make_pair(i, i+1));
+  }
+  // Churn through tombstones
+  for (int i = 0; i < 10000; ++i) {
+    s.erase(i);
+    s.put(make_pair(i + 10000, i));
+  }
+  EXPECT_EQ(s.size(), 10000);
+  s.close();
+  EXPECT_EQ(remove((path + ".tmp").c_str()), -1);
+
+  s.open(path);
+  EXPECT_EQ(s.size(), 10000);
+  size_t n = 0;
+  for (const auto& v : s) {
+    EXPECT_EQ(v.first, v.second + 10000);
+    ++n;
+  }
+  EXPECT_EQ(n, 10000);
+}
+
+// Crash consistency test
+TEST(mmap_store, recovery) {
+  const auto path = temp_path("recovery");
+  // A child process exits without closing, as a crash would
+  const auto pid = fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    MmapStore<int, int> s(path);
+    for (int i = 0; i < 10; ++i) {
+      s.put(make_pair(i, i));
+    }
+    s.checkpoint();
+    s.put(make_pair(10, 10));
+    s.erase(0);
+    _exit(0);
+  }
+  waitpid(pid, nullptr, 0);
+
+  // The newest header is marked as not checkpointed, so the size is recounted
+  {
+    MmapStore<int, int> s(path);
+    EXPECT_EQ(s.size(), 10);
+    EXPECT_TRUE(s.contains(10));
+    EXPECT_FALSE(s.contains(0));
+  }
+
+  // A torn header falls back on the other copy
+  {
+    fstream f(path, ios::in | ios::out | ios::binary);
+    char hs[2][64];
+    f.read(hs[0], 64);
+    f.seekg(2048);
+    f.read(hs[1], 64);
+    uint64_t gens[2];
+    memcpy(&gens[0], hs[0] + 56, 8);
+    memcpy(&gens[1], hs[1] + 56, 8);
+    f.seekp(gens[0] > gens[1] ? 0 : 2048);
+    f.write("garbage", 7);
+  }
+  MmapStore<int, int> s(path);
+  EXPECT_TRUE(s.is_open());
+  EXPECT_EQ(s.size(), 10);
+  s.put(make_pair(0, 0));
+  EXPECT_EQ(s.size(), 11);
+}
+
+// Torn slot test
+TEST(mmap_store, torn) {
+  const auto path = temp_path("torn");
+  const auto pid = fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    MmapStore<int, int> s(path);
+    for (int i = 0; i < 10; ++i) {
+      s.put(make_pair(i, i));
+    }
+    _exit(0);
+  }
+  waitpid(pid, nullptr, 0);
+
+  // The control byte of 5 reached the file, but its slot did not
+  {
+    fstream f(path, ios::in | ios::out | ios::binary);
+    const string bytes((istreambuf_iterator<char>(f)), istreambuf_iterator<char>());
+    const int kv[2] = {5, 5};
+    size_t off = 4096;
+    while (memcmp(bytes.data() + off, kv, sizeof(kv)) != 0) {
+      off += sizeof(kv);
+      ASSERT_LT(off, bytes.size());
+    }
+    const int garbage = 1000;
+    f.seekp(off);
+    f.write(reinterpret_cast<const char*>(&garbage), sizeof(garbage));
+  }
+
+  MmapStore<int, int> s(path);
+  EXPECT_EQ(s.size(), 9);
+  EXPECT_FALSE(s.contains(5));
+  EXPECT_FALSE(s.contains(1000));
+  for (int i = 0; i < 10; ++i) {
+    s.put(make_pair(i, -i));
+  }
+  EXPECT_EQ(s.size(), 10);
+  EXPECT_EQ(s.get(9), -9);
+}
+
+// Cache test
+TEST(mmap_store, cache) {
+  const auto path = temp_path("cache");
+  {
+    Store<int, int> p;
+    MmapStore<int, int> b(path);
+    Cache<decltype(p), decltype(b)> c(&p, &b, 8);
+    for (int i = 0; i < 32; ++i) {
+      c.put(make_pair(i, i * i));
+    }
+  }
+  MmapStore<int, int> b(path);
+  EXPECT_EQ(b.size(), 32);
+  EXPECT_EQ(b.get(5), 25);
+}
+
+// Cache over mapped primary test
+TEST(mmap_store, primary) {
+  MmapStore<int, int> p(temp_path("primary"));
+  Store<int, int> b;
+  for (int i = 0; i < 64; ++i) {
+    b.put(make_pair(i, -i));
+  }
+  Cache<decltype(p), decltype(b), Sieve<decltype(p)>> c(&p, &b, 16);
+  for (int i = 0; i < 64; ++i) {
+    EXPECT_EQ(c.get(i), -i);
+  }
+  EXPECT_EQ(p.size(), 16);
+}
@@ -0,0 +1,97 @@
+#include <chrono>
+#include <thread>
+#include "gtest/gtest.h"
+#include "include/near.h"
+#include "include/redis.h"
+#include "test/interface.h"
+
+using namespace binder;
+
+// Connection test
+TEST(near_cache, connection) {
+  NearCache<char, int> s;
+  EXPECT_FALSE(s.is_connected());
+  EXPECT_FALSE(s.is_tracking());
+
+  s.connect("localhost", 1);
+  EXPECT_FALSE(s.is_connected());
+  EXPECT_FALSE(s.is_tracking());
+
+  s.connect("localhost", 6379);
+  EXPECT_TRUE(s.is_connected());
+  EXPECT_TRUE(s.is_tracking());
+
+  // Copies open their own connections
+  NearCache<char, int> s1(s);
+  s.disconnect();
+  EXPECT_FALSE(s.is_connected());
+  EXPECT_FALSE(s.is_tracking());
+  EXPECT_TRUE(s1.is_connected());
+  EXPECT_TRUE(s1.is_tracking());
+}
+
+// Basic test
+TEST(near_cache, basic) {
+  NearCache<char, int> s("localhost", 6379);
+  basic(s);
+}
+
+// The store interface isn't const, so checks a copy of the near store
+template <typename S, typename K>
+bool cached(const S& s, const K& k) {
+  auto ns = s.near_store();
+  return ns.contains(k);
+}
+
+// Invalidations are pushed by the server and only read as requests are made,
+// so retries f, which should make one, until it holds or a deadline passes
+template <typename F>
+bool eventually(F f) {
+  const auto deadline = chrono::steady_clock::now() + chrono::seconds(2);
+  while (!f()) {
+    if (chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    this_thread::sleep_for(chrono::milliseconds(1));
+  }
+  return true;
+}
+
+// Invalidation test
+TEST(near_cache, invalidation) {
+  RedisStore<int, int> rs("localhost", 6379);
+  NearCache<int, int> s("localhost", 6379, 4);
+  rs.clear();
+  for (int i = 0; i < 8; ++i) {
+    rs.put(make_pair(i, i));
+  }
+
+  // Reads are kept locally, up to capacity
+  for (int i = 0; i < 8; ++i) {
+    EXPECT_EQ(s.get(i), i);
+  }
+  EXPECT_EQ(s.near_store().size(), 4);
+  EXPECT_TRUE(cached(s, 7));
+  EXPECT_FALSE(cached(s, 0));
+  EXPECT_EQ(s.get(7), 7);
+
+  // Another writer's changes evict the local copy
+  rs.put(make_pair(7, 70));
+  EXPECT_TRUE(eventually([&]{ return s.get(7) == 70; }));
+  rs.erase(6);
+  EXPECT_TRUE(eventually([&]{ return !s.contains(6); }));
+  EXPECT_EQ(s.get(6), int());
+  EXPECT_FALSE(cached(s, 6));
+
+  // As do our own
+  s.put(make_pair(5, 50));
+  EXPECT_FALSE(cached(s, 5));
+  EXPECT_EQ(s.get(5), 50);
+  EXPECT_EQ(rs.get(5), 50);
+
+  // And flushes
+  EXPECT_FALSE(s.near_store().empty());
+  rs.clear();
+  EXPECT_TRUE(eventually([&]{ return s.get(5) == int(); }));
+  EXPECT_TRUE(s.near_store().empty());
+}
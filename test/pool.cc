@@ -0,0 +1,44 @@
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "include/pool.h"
+
+using namespace binder;
+using namespace std;
+
+// Concurrent leases test
+TEST(redis_pool, concurrent) {
+  RedisPool<int, int> p("localhost", 6379, 2);
+  EXPECT_EQ(p.size(), 2);
+  p.lease()->clear();
+
+  // More threads than connections
+  vector<thread> ts;
+  for (int t = 0; t < 4; ++t) {
+    ts.emplace_back([&p, t]{
+      for (int i = 0; i < 100; ++i) {
+        auto rs = p.lease();
+        rs->put(make_pair(t*100 + i, i));
+        EXPECT_EQ(rs->get(t*100 + i), i);
+      }
+    });
+  }
+  for (auto& t : ts) {
+    t.join();
+  }
+  EXPECT_EQ(p.lease()->size(), 400);
+  EXPECT_EQ(p.reconnects(), 0);
+}
+
+// Reconnection test
+TEST(redis_pool, reconnect) {
+  RedisPool<int, int> p("localhost", 6379, 1);
+  {
+    auto rs = p.lease();
+    EXPECT_TRUE(rs->is_connected());
+    rs->disconnect();
+  }
+  auto rs = p.lease();
+  EXPECT_TRUE(rs->is_connected());
+  EXPECT_EQ(p.reconnects(), 1);
+}
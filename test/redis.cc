@@ -1,5 +1,11 @@
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <vector>
 #include "gtest/gtest.h"
+#include "include/cache.h"
 #include "include/redis.h"
+#include "include/store.h"
 #include "test/interface.h"
 
 using namespace binder;
@@ -43,6 +49,129 @@ TEST(redis_store, connection) {
 TEST(redis_store, basic) {
   RedisStore<char, int> s("localhost", 6379);
   basic(s);
+  iterators(s);
+}
+
+// Batched test
+TEST(redis_store, batched) {
+  RedisStore<char, int> s("localhost", 6379);
+  batched(s);
+}
+
+// Lookup test
+TEST(redis_store, lookup) {
+  RedisStore<int, int> s("localhost", 6379);
+  s.clear();
+  s.put(make_pair(1, 0));
+
+  // A present key with a default value is told apart from a missing one
+  int v = -1;
+  EXPECT_TRUE(s.lookup(1, v));
+  EXPECT_EQ(v, 0);
+  v = -1;
+  EXPECT_FALSE(s.lookup(2, v));
+  EXPECT_EQ(v, -1);
+
+  // And for many keys at once
+  s.put(make_pair(3, 4));
+  const vector<int> ks = {1, 2, 3};
+  vector<pair<int, int>> vs;
+  s.multi_lookup(ks.begin(), ks.end(), back_inserter(vs));
+  EXPECT_EQ(vs, (vector<pair<int, int>>{{1, 0}, {3, 4}}));
+
+  s.disconnect();
+  EXPECT_FALSE(s.lookup(1, v));
+  vs.clear();
+  s.multi_lookup(ks.begin(), ks.end(), back_inserter(vs));
+  EXPECT_TRUE(vs.empty());
+}
+
+// Pipeline test
+TEST(redis_store, pipeline) {
+  RedisStore<int, int> s("localhost", 6379);
+  s.clear();
+  {
+    auto p = s.pipeline(7);
+    for (int i = 0; i < 100; ++i) {
+      p.put(make_pair(i, i+1));
+    }
+    p.erase(0);
+    auto c0 = p.contains(0);
+    auto c1 = p.contains(1);
+    auto g1 = p.get(1);
+    auto g2 = p.get(200);
+    p.flush();
+
+    EXPECT_FALSE(c0.get());
+    EXPECT_TRUE(c1.get());
+    EXPECT_EQ(g1.get(), 2);
+    EXPECT_EQ(g2.get(), int());
+    EXPECT_EQ(p.errors(), 0);
+
+    // Commands still queued when the pipeline goes out of scope are flushed
+    p.put(make_pair(200, 201));
+  }
+  EXPECT_EQ(s.size(), 100);
+  EXPECT_EQ(s.get(200), 201);
+
+  // A disconnected pipeline resolves everything immediately
+  s.disconnect();
+  auto p = s.pipeline();
+  p.put(make_pair(1, 1));
+  EXPECT_FALSE(p.contains(1).get());
+  EXPECT_EQ(p.get(1).get(), int());
+}
+
+// Binary codec test
+TEST(redis_store, binary) {
+  RedisStore<char, int, Binary<char, int>> s("localhost", 6379);
+  basic(s);
+  batched(s);
+
+  // Values are stored as raw bytes, and strings as themselves
+  RedisStore<string, double, Binary<string, double>> s1("localhost", 6379);
+  s1.clear();
+  s1.put(make_pair(string("a"), 1.5));
+  EXPECT_EQ(s1.get("a"), 1.5);
+  EXPECT_EQ(s1.begin()->first, "a");
+  RedisStore<string, string> s2("localhost", 6379);
+  EXPECT_EQ(s2.get("a").length(), sizeof(double));
+}
+
+// Scan test
+TEST(redis_store, scan) {
+  RedisStore<int, int> s("localhost", 6379);
+  s.clear();
+  for (int i = 0; i < 100; ++i) {
+    s.put(make_pair(i, i+1));
+  }
+
+  // Pages smaller than the store, including a page size of one
+  for (auto c : {1, 7, 1000}) {
+    s.set_scan_count(c);
+    vector<bool> seen(100, false);
+    size_t n = 0;
+    for (const auto& v : s) {
+      EXPECT_EQ(v.second, v.first+1);
+      seen[v.first] = true;
+      ++n;
+    }
+    EXPECT_EQ(n, 100);
+    EXPECT_EQ(count(seen.begin(), seen.end(), true), 100);
+  }
+
+  // Copies share a position without rescanning
+  s.set_scan_count(7);
+  auto i = s.begin();
+  for (int j = 0; j < 10; ++j) {
+    ++i;
+  }
+  auto i2 = i;
+  EXPECT_EQ(i, i2);
+  EXPECT_EQ(*i, *i2);
+  ++i2;
+  EXPECT_NE(i, i2);
+  EXPECT_EQ(distance(i, s.end()), 90);
 }
 
 // Disconnected functionality test
@@ -82,3 +211,26 @@ TEST(redis_store, disconnected) {
   EXPECT_TRUE(s.contains(1));
   s.disconnect();
 }
+
+// Write behind test
+TEST(redis_store, write_behind) {
+  typedef RedisStore<int, int> S;
+  S b("localhost", 6379);
+  b.clear();
+
+  // The writer thread has its own connection, so gets may read b meanwhile,
+  // and it writes whatever is waiting before it stops
+  {
+    Store<int, int> p;
+    Cache<Store<int, int>, S, Lru<Store<int, int>>, Fetch<S>, WriteBehind<S>> s(&p, &b, 8);
+    for (int i = 0; i < 100; ++i) {
+      s.put(make_pair(i, i+1));
+      EXPECT_EQ(s.get(i/2), i/2+1);
+    }
+    s.clear();
+  }
+  EXPECT_EQ(b.size(), 100);
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(b.get(i), i+1);
+  }
+}
@@ -0,0 +1,153 @@
+#include <set>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "include/ring.h"
+#include "test/interface.h"
+
+using namespace binder;
+using namespace std;
+
+// These tests expect servers on ports 6379-6381 (see bin/db_create)
+static const vector<pair<string, unsigned int>> eps {
+  {"localhost", 6379}, {"localhost", 6380}, {"localhost", 6381}
+};
+
+// Hash ring test
+TEST(hash_ring, remap) {
+  HashRing r;
+  r.add("a", 0);
+  r.add("b", 1);
+  r.add("c", 2);
+
+  // Keys are spread roughly evenly
+  vector<size_t> owner;
+  vector<size_t> counts(3, 0);
+  for (uint64_t h = 0; h < 30000; ++h) {
+    owner.push_back(r.find(h));
+    ++counts[owner.back()];
+  }
+  for (auto c : counts) {
+    EXPECT_GT(c, 7000);
+    EXPECT_LT(c, 13000);
+  }
+
+  // Adding a node only moves keys onto it, and only about its share
+  r.add("d", 3);
+  size_t moved = 0;
+  for (uint64_t h = 0; h < 30000; ++h) {
+    const auto o = r.find(h);
+    if (o != owner[h]) {
+      EXPECT_EQ(o, 3);
+      ++moved;
+    }
+  }
+  EXPECT_GT(moved, 4500);
+  EXPECT_LT(moved, 10500);
+
+  // Removing it again moves them all back
+  r.remove(3);
+  for (uint64_t h = 0; h < 30000; ++h) {
+    EXPECT_EQ(r.find(h), owner[h]);
+  }
+
+  // Removing a node renumbers those after it
+  r.remove(0);
+  for (uint64_t h = 0; h < 30000; ++h) {
+    if (owner[h] != 0) {
+      EXPECT_EQ(r.find(h), owner[h]-1);
+    }
+  }
+}
+
+// Connection test
+TEST(sharded_redis_store, connection) {
+  ShardedRedisStore<int, int> s;
+  EXPECT_FALSE(s.is_connected());
+  EXPECT_EQ(s.shards(), 0);
+  EXPECT_FALSE(s.contains(1));
+  EXPECT_EQ(s.begin(), s.end());
+
+  s.add("localhost", 6379);
+  EXPECT_TRUE(s.is_connected());
+  s.add("localhost", 1);
+  EXPECT_FALSE(s.is_connected());
+  s.remove("localhost", 1);
+  EXPECT_TRUE(s.is_connected());
+  EXPECT_EQ(s.shards(), 1);
+}
+
+// Empty store test
+TEST(sharded_redis_store, empty) {
+  // Every operation does nothing without endpoints
+  ShardedRedisStore<int, int> s;
+  vector<pair<int, int>> vs = {{1, 1}, {2, 2}};
+  vector<int> ks = {1, 2};
+  multi_put(s, vs.begin(), vs.end());
+  multi_erase(s, ks.begin(), ks.end());
+  vector<int> gs;
+  multi_get(s, ks.begin(), ks.end(), back_inserter(gs));
+  EXPECT_EQ(gs, vector<int>({0, 0}));
+  s.put(make_pair(1, 1));
+  s.erase(1);
+  EXPECT_EQ(s.get(1), 0);
+  EXPECT_TRUE(s.empty());
+}
+
+// Basic test
+TEST(sharded_redis_store, basic) {
+  ShardedRedisStore<char, int> s(eps);
+  basic(s);
+  iterators(s);
+}
+
+// Batched test
+TEST(sharded_redis_store, batched) {
+  ShardedRedisStore<char, int> s(eps);
+  batched(s);
+}
+
+// Sharding test
+TEST(sharded_redis_store, sharding) {
+  ShardedRedisStore<int, int> s(eps);
+  s.clear();
+  vector<pair<int, int>> vs;
+  for (int i = 0; i < 300; ++i) {
+    vs.push_back(make_pair(i, i+1));
+  }
+  multi_put(s, vs.begin(), vs.end());
+  EXPECT_EQ(s.size(), 300);
+
+  // Every key lives on exactly the shard that owns it
+  for (size_t i = 0; i < eps.size(); ++i) {
+    RedisStore<int, int> rs(eps[i].first, eps[i].second);
+    EXPECT_GT(rs.size(), 50);
+    for (const auto& v : rs) {
+      EXPECT_EQ(s.shard(v.first), i);
+    }
+  }
+
+  // Iteration visits every shard
+  set<int> keys;
+  for (const auto& v : s) {
+    EXPECT_EQ(v.second, v.first+1);
+    keys.insert(v.first);
+  }
+  EXPECT_EQ(keys.size(), 300);
+
+  // Batches spanning every shard come back in key order
+  vector<int> ks;
+  for (int i = 299; i >= -10; --i) {
+    ks.push_back(i);
+  }
+  vector<int> gs;
+  multi_get(s, ks.begin(), ks.end(), back_inserter(gs));
+  vector<bool> cs;
+  multi_contains(s, ks.begin(), ks.end(), back_inserter(cs));
+  for (size_t i = 0; i < ks.size(); ++i) {
+    EXPECT_EQ(gs[i], ks[i] >= 0 ? ks[i]+1 : int());
+    EXPECT_EQ(cs[i], ks[i] >= 0);
+  }
+  multi_erase(s, ks.begin(), ks.begin() + 100);
+  EXPECT_EQ(s.size(), 200);
+}
@@ -0,0 +1,60 @@
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "include/cache.h"
+#include "include/flat.h"
+#include "include/sharded.h"
+#include "include/store.h"
+#include "test/interface.h"
+
+using namespace binder;
+
+// Basic tests
+TEST(sharded_store, basic) {
+  ShardedStore<char, int> s(4);
+  basic(s);
+}
+TEST(sharded_store, flat) {
+  ShardedStore<char, int, FlatStore<char, int>> s(4);
+  basic(s);
+  iterators(s);
+}
+
+// Layering test
+TEST(sharded_store, cache) {
+  ShardedStore<char, int, Store<char, int>> p(4);
+  Store<char, int> b;
+  Cache<decltype(p), decltype(b)> s(&p, &b, 26);
+  basic(s);
+}
+
+// Concurrent writers and readers test
+TEST(sharded_store, concurrent) {
+  ShardedStore<int, int> s(8);
+  const int n = 8;
+  const int m = 1000;
+
+  std::vector<std::thread> ts;
+  for (int t = 0; t < n; ++t) {
+    ts.emplace_back([&s, t]{
+      for (int i = 0; i < m; ++i) {
+        s.put(make_pair(t*m + i, i));
+        EXPECT_EQ(s.get(t*m + i), i);
+      }
+      for (int i = 0; i < m; i += 2) {
+        s.erase(t*m + i);
+      }
+    });
+  }
+  for (auto& t : ts) {
+    t.join();
+  }
+
+  EXPECT_EQ(s.size(), n*m/2);
+  size_t count = 0;
+  for (const auto& v : s) {
+    EXPECT_EQ(v.first % 2, 1);
+    ++count;
+  }
+  EXPECT_EQ(count, n*m/2);
+}
@@ -13,3 +13,9 @@ TEST(unordered_store, basic) {
   UnorderedStore<char, int> s;
   basic(s);
 }
+
+// Batched tests
+TEST(store, batched) {
+  Store<char, int> s;
+  batched(s);
+}
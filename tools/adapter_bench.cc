@@ -0,0 +1,101 @@
+#include <cstdint>
+#include "include/adapter.h"
+#include "include/flat.h"
+#include "include/store.h"
+#include "tools/bench.h"
+
+using namespace binder;
+using namespace std;
+
+// Scans s, reading each key and value, and gets every key one at a time and
+// in one batch
+template <typename S>
+void run(const string& name, S& s, const vector<int64_t>& ks, size_t scans) {
+  bench(name + "::scan", scans * ks.size(), [&]{
+    double sum = 0;
+    for (size_t i = 0; i < scans; ++i) {
+      for (const auto& v : s) {
+        sum += v.first + v.second;
+      }
+    }
+    return sum;
+  });
+  bench(name + "::get", ks.size(), [&]{
+    double sum = 0;
+    for (auto k : ks) {
+      sum += s.get(k);
+    }
+    return sum;
+  });
+  vector<double> vs;
+  vs.reserve(ks.size());
+  bench(name + "::multi_get", ks.size(), [&]{
+    vs.clear();
+    binder::multi_get(s, ks.begin(), ks.end(), back_inserter(vs));
+    return vs[ks.size() / 2];
+  });
+}
+
+// Converts n values with Cast one at a time and in bulk, against a plain copy
+// of the same number of bytes
+template <typename From, typename To>
+void convert(const string& name, size_t n, size_t reps) {
+  vector<From> in(n);
+  for (size_t i = 0; i < n; ++i) {
+    in[i] = (From) ((double) i * 1.5 - (double) n / 2);
+  }
+  vector<To> out(n);
+  Cast<From, From, To, To> m;
+  bench(name + " (kmap)", n * reps, [&]{
+    for (size_t r = 0; r < reps; ++r) {
+      for (size_t i = 0; i < n; ++i) {
+        out[i] = m.kmap(in[i]);
+      }
+    }
+    return out[n / 2];
+  });
+  bench(name + " (kmap_n)", n * reps, [&]{
+    for (size_t r = 0; r < reps; ++r) {
+      m.kmap_n(in.data(), n, out.data());
+    }
+    return out[n / 2];
+  });
+  vector<From> copy(n);
+  bench(name + " (memcpy)", n * reps, [&]{
+    for (size_t r = 0; r < reps; ++r) {
+      copy = in;
+    }
+    return copy[n / 2];
+  });
+}
+
+int main() {
+  const auto ks = keys(1 << 20, 1);
+  const size_t scans = 16;
+
+  FlatStore<int64_t, double> f;
+  for (auto k : ks) {
+    f.put(make_pair(k, (double)k));
+  }
+  AdapterStore<int64_t, double, decltype(f)> af(&f);
+  run("FlatStore", f, ks, scans);
+  run("AdapterStore<FlatStore>", af, ks, scans);
+
+  UnorderedStore<int64_t, double> u;
+  for (auto k : ks) {
+    u.put(make_pair(k, (double)k));
+  }
+  AdapterStore<int64_t, double, decltype(u)> au(&u);
+  run("UnorderedStore", u, ks, scans);
+  run("AdapterStore<UnorderedStore>", au, ks, scans);
+
+  const size_t n = 1 << 20;
+  const size_t reps = 64;
+  convert<double, int32_t>("Cast<double, int32_t>", n, reps);
+  convert<int32_t, double>("Cast<int32_t, double>", n, reps);
+  convert<float, int32_t>("Cast<float, int32_t>", n, reps);
+  convert<double, int64_t>("Cast<double, int64_t>", n, reps);
+  convert<int64_t, int64_t>("Cast<int64_t, int64_t>", n, reps);
+
+  return 0;
+}
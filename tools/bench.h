@@ -0,0 +1,66 @@
+#ifndef BINDER_TOOLS_BENCH_H
+#define BINDER_TOOLS_BENCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace binder {
+
+// Returns n distinct pseudo-random keys in a fixed order
+inline std::vector<int64_t> keys(size_t n, uint64_t seed = 1) {
+  std::vector<int64_t> res(n);
+  std::mt19937_64 gen(seed);
+  for (size_t i = 0; i < n; ++i) {
+    res[i] = (int64_t)((gen() << 32) | i);
+  }
+  std::shuffle(res.begin(), res.end(), gen);
+  return res;
+}
+
+// Times a single invocation of f, which performs ops operations and returns
+// a checksum that keeps the compiler from discarding the work
+template <typename F>
+void bench(const std::string& name, size_t ops, F f) {
+  const auto begin = std::chrono::steady_clock::now();
+  const volatile auto sum = f();
+  const auto end = std::chrono::steady_clock::now();
+  (void) sum;
+
+  const auto secs = std::chrono::duration<double>(end - begin).count();
+  std::cout << std::left << std::setw(48) << name 
+            << std::right << std::setw(10) << std::fixed << std::setprecision(2) 
+            << (ops / secs / 1e6) << " Mops/s" << std::endl;
+}
+
+// Times threads threads each invoking f(t), which performs ops operations and
+// returns a checksum. Each checksum is stored once its thread is done, since
+// neighbouring elements of one vector share a cache line.
+template <typename F>
+void bench_threads(const std::string& name, size_t threads, size_t ops, F f) {
+  bench(name, threads * ops, [&]{
+    std::vector<std::thread> ts;
+    std::vector<double> sums(threads);
+    for (size_t t = 0; t < threads; ++t) {
+      ts.emplace_back([&, t]{
+        sums[t] = f(t);
+      });
+    }
+    double sum = 0;
+    for (size_t t = 0; t < threads; ++t) {
+      ts[t].join();
+      sum += sums[t];
+    }
+    return sum;
+  });
+}
+
+} // namespace binder
+
+#endif
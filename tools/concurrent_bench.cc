@@ -0,0 +1,81 @@
+#include <cstdint>
+#include <mutex>
+#include "include/cache.h"
+#include "include/concurrent.h"
+#include "include/flat.h"
+#include "include/sharded.h"
+#include "include/store.h"
+#include "tools/bench.h"
+
+using namespace binder;
+using namespace std;
+
+typedef FlatStore<int64_t, double> Primary;
+typedef ShardedStore<int64_t, double> Backing;
+
+// The status quo: one Cache behind one lock
+class Locked {
+  public:
+    Locked(Backing* b, size_t c) : c_(&p_, b, c) { }
+
+    double get(int64_t k) {
+      lock_guard<mutex> lock(m_);
+      return c_.get(k);
+    }
+    void put(const pair<const int64_t, double>& v) {
+      lock_guard<mutex> lock(m_);
+      c_.put(v);
+    }
+
+  private:
+    mutex m_;
+    Primary p_;
+    Cache<Primary, Backing, HashLru<Primary>> c_;
+};
+
+// Each thread performs ops gets, all of which hit, or one in ten of which
+// miss and evict
+template <typename C>
+void run(const string& name, C& c, const vector<int64_t>& ks, size_t hot, size_t threads, size_t ops) {
+  for (size_t i = 0; i < hot; ++i) {
+    c.put(make_pair(ks[i], (double)ks[i]));
+  }
+  const auto miss = hot < ks.size();
+  bench_threads(name + (miss ? " (90% hits, " : " (hits, ") + to_string(threads) + " threads)", threads, ops, [&](size_t t){
+    double sum = 0;
+    for (size_t i = 0, j = t * 7919; i < ops; ++i, j += 31) {
+      const auto k = miss && i % 10 == 0 ? ks[hot + j % (ks.size() - hot)] : ks[j % hot];
+      sum += c.get(k);
+    }
+    return sum;
+  });
+}
+
+int main() {
+  const auto ks = keys(1 << 18);
+  const size_t hot = 1 << 16;
+  const size_t ops = 1 << 20;
+
+  Backing b(256);
+  for (auto k : ks) {
+    b.put(make_pair(k, (double)k));
+  }
+
+  // Capacity is split evenly between shards, so leave headroom for keys which
+  // don't split evenly
+  const size_t c = 2 * hot;
+  const vector<int64_t> hs(ks.begin(), ks.begin() + hot);
+  for (size_t threads = 1; threads <= 8; threads *= 2) {
+    Locked l1(&b, c);
+    run("Locked<Cache>", l1, hs, hot, threads, ops);
+    ConcurrentCache<Primary, Backing, HashLru<Primary>> c1(&b, c, 64);
+    run("ConcurrentCache", c1, hs, hot, threads, ops);
+
+    Locked l2(&b, c);
+    run("Locked<Cache>", l2, ks, hot, threads, ops);
+    ConcurrentCache<Primary, Backing, HashLru<Primary>> c2(&b, c, 64);
+    run("ConcurrentCache", c2, ks, hot, threads, ops);
+  }
+
+  return 0;
+}
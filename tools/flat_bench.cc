@@ -0,0 +1,57 @@
+#include <cstdint>
+#include "include/flat.h"
+#include "include/store.h"
+#include "tools/bench.h"
+
+using namespace binder;
+using namespace std;
+
+template <typename S>
+void run(const string& name, const vector<int64_t>& ks, const vector<int64_t>& misses) {
+  S s;
+  bench(name + "::put", ks.size(), [&]{
+    for (auto k : ks) {
+      s.put(make_pair(k, (double)k));
+    }
+    return s.size();
+  });
+  bench(name + "::get (hit)", ks.size(), [&]{
+    double sum = 0;
+    for (auto k : ks) {
+      sum += s.get(k);
+    }
+    return sum;
+  });
+  bench(name + "::contains (miss)", misses.size(), [&]{
+    size_t sum = 0;
+    for (auto k : misses) {
+      sum += s.contains(k);
+    }
+    return sum;
+  });
+  bench(name + "::iterate", s.size(), [&]{
+    double sum = 0;
+    for (const auto& v : s) {
+      sum += v.second;
+    }
+    return sum;
+  });
+  bench(name + "::erase", ks.size(), [&]{
+    for (auto k : ks) {
+      s.erase(k);
+    }
+    return s.size();
+  });
+}
+
+int main() {
+  const size_t n = 1 << 22;
+  const auto ks = keys(n, 1);
+  const auto misses = keys(n, 2);
+
+  run<Store<int64_t, double>>("Store", ks, misses);
+  run<UnorderedStore<int64_t, double>>("UnorderedStore", ks, misses);
+  run<FlatStore<int64_t, double>>("FlatStore", ks, misses);
+
+  return 0;
+}
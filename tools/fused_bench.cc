@@ -0,0 +1,79 @@
+#include <cstdint>
+#include "include/cache.h"
+#include "include/evict.h"
+#include "include/flat.h"
+#include "include/fused.h"
+#include "include/store.h"
+#include "include/write.h"
+#include "tools/bench.h"
+
+using namespace binder;
+using namespace std;
+
+typedef FlatStore<int64_t, double> Primary;
+typedef UnorderedStore<int64_t, double> Backing;
+
+// Gets which all hit, puts which all overwrite a resident key, and gets of
+// which one in ten misses and evicts
+template <typename C>
+void run(const string& name, C& c, Backing& b, const vector<int64_t>& ks, size_t hot, size_t ops) {
+  for (auto k : ks) {
+    b.put(make_pair(k, (double)k));
+  }
+  for (size_t i = 0; i < hot; ++i) {
+    c.get(ks[i]);
+  }
+  bench(name + "::get (hit)", ops, [&]{
+    double sum = 0;
+    for (size_t i = 0, j = 0; i < ops; ++i, j += 31) {
+      sum += c.get(ks[j % hot]);
+    }
+    return sum;
+  });
+  bench(name + "::put (hit)", ops, [&]{
+    for (size_t i = 0, j = 0; i < ops; ++i, j += 31) {
+      c.put(make_pair(ks[j % hot], (double)i));
+    }
+    return c.size();
+  });
+  bench(name + "::get (90% hits)", ops, [&]{
+    double sum = 0;
+    for (size_t i = 0, j = 0; i < ops; ++i, j += 31) {
+      sum += c.get(i % 10 == 0 ? ks[hot + j % (ks.size() - hot)] : ks[j % hot]);
+    }
+    return sum;
+  });
+}
+
+int main() {
+  const auto ks = keys(1 << 20, 1);
+  const size_t hot = 1 << 16;
+  const size_t ops = 1 << 23;
+
+  {
+    Primary p;
+    Backing b;
+    Cache<Primary, Backing, HashLru<Primary>, Fetch<Backing>, WriteBack<Backing>> c(&p, &b, hot);
+    run("Cache<HashLru, WriteBack>", c, b, ks, hot, ops);
+  }
+  {
+    Backing b;
+    FusedCache<Backing, HashLru<Backing>, Fetch<Backing>, WriteBack<Backing>> c(&b, hot);
+    c.reserve(hot + 1);
+    run("FusedCache<HashLru, WriteBack>", c, b, ks, hot, ops);
+  }
+  {
+    Primary p;
+    Backing b;
+    Cache<Primary, Backing, Sieve<Primary>, Fetch<Backing>, WriteBack<Backing>> c(&p, &b, hot);
+    run("Cache<Sieve, WriteBack>", c, b, ks, hot, ops);
+  }
+  {
+    Backing b;
+    FusedCache<Backing, Sieve<Backing>, Fetch<Backing>, WriteBack<Backing>> c(&b, hot);
+    c.reserve(hot + 1);
+    run("FusedCache<Sieve, WriteBack>", c, b, ks, hot, ops);
+  }
+
+  return 0;
+}
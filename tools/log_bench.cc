@@ -0,0 +1,116 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include "include/log.h"
+#include "include/multi.h"
+#include "include/redis.h"
+#include "tools/bench.h"
+
+using namespace binder;
+using namespace std;
+
+// Puts every key one at a time and in batches, then gets and scans them
+template <typename S>
+void run(const string& name, S& s, const vector<int64_t>& ks) {
+  const auto n = ks.size();
+  s.clear();
+  bench(name + "::put", n, [&]{
+    for (auto k : ks) {
+      s.put(make_pair(k, (double)k));
+    }
+    return s.size();
+  });
+
+  s.clear();
+  bench("multi_put(" + name + ") (1024 per batch)", n, [&]{
+    vector<pair<int64_t, double>> vs;
+    for (size_t i = 0; i < n; i += 1024) {
+      vs.clear();
+      for (size_t j = i; j < min(n, i + 1024); ++j) {
+        vs.push_back(make_pair(ks[j], (double)ks[j]));
+      }
+      multi_put(s, vs.begin(), vs.end());
+    }
+    return s.size();
+  });
+
+  bench(name + "::get", n, [&]{
+    double sum = 0;
+    for (auto k : ks) {
+      sum += s.get(k);
+    }
+    return sum;
+  });
+  bench(name + "::scan", n, [&]{
+    double sum = 0;
+    for (const auto& v : s) {
+      sum += v.second;
+    }
+    return sum;
+  });
+}
+
+// Usage: log_bench [keys] [path] [host] [port]
+int main(int argc, char** argv) {
+  const size_t n = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1000000;
+  const string path = argc > 2 ? argv[2] : "log_bench.log";
+  const string host = argc > 3 ? argv[3] : "localhost";
+  const unsigned int port = argc > 4 ? atoi(argv[4]) : 6379;
+  const auto ks = keys(n);
+
+  {
+    LogStore<int64_t, double> s(path, LogSync::NONE);
+    if (!s.is_open()) {
+      cerr << "Unable to open " << path << endl;
+      return 1;
+    }
+    s.set_compaction(1);
+    run("LogStore<NONE>", s, ks);
+    s.set_sync(LogSync::GROUP);
+    run("LogStore<GROUP>", s, ks);
+
+    // Overwrite every key, then time a compaction and gets during one
+    for (auto k : ks) {
+      s.put(make_pair(k, (double)-k));
+    }
+    bench("LogStore::compact (per live key)", n, [&]{
+      s.compact();
+      s.wait();
+      return s.file_size();
+    });
+    for (auto k : ks) {
+      s.put(make_pair(k, (double)k));
+    }
+    s.compact();
+    bench("LogStore::get (while compacting)", n, [&]{
+      double sum = 0;
+      for (auto k : ks) {
+        sum += s.get(k);
+      }
+      return sum;
+    });
+    s.wait();
+
+    // A sync for every put is bounded by the disk, so only time a few
+    const vector<int64_t> few(ks.begin(), ks.begin() + min(n, (size_t)1000));
+    s.set_sync(LogSync::EACH);
+    s.clear();
+    bench("LogStore<EACH>::put", few.size(), [&]{
+      for (auto k : few) {
+        s.put(make_pair(k, (double)k));
+      }
+      return s.size();
+    });
+    s.clear();
+  }
+  remove(path.c_str());
+
+  RedisStore<int64_t, double, Binary<int64_t, double>> r(host, port);
+  if (!r.is_connected()) {
+    cerr << "Unable to connect to " << host << ":" << port << "; skipping RedisStore" << endl;
+    return 0;
+  }
+  run("RedisStore<Binary>", r, ks);
+  r.clear();
+  return 0;
+}
@@ -0,0 +1,163 @@
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include "include/evict.h"
+#include "include/store.h"
+#include "tools/bench.h"
+
+using namespace binder;
+using namespace std;
+
+// Fills e with ks, then replays hits over ks and a churn of evictions which
+// replace the least recently used key with a miss
+template <typename E>
+void run(const string& name, const vector<int64_t>& ks, const vector<int64_t>& misses) {
+  E e;
+  bench(name + "::touch (insert)", ks.size(), [&]{
+    for (auto k : ks) {
+      e.touch(k);
+    }
+    return e.evict();
+  });
+  bench(name + "::touch (hit)", ks.size(), [&]{
+    for (auto k : ks) {
+      e.touch(k);
+    }
+    return e.evict();
+  });
+  bench(name + "::evict + erase + touch", misses.size(), [&]{
+    int64_t sum = 0;
+    for (auto k : misses) {
+      const auto v = e.evict();
+      sum += v;
+      e.erase(v);
+      e.touch(k);
+    }
+    return sum;
+  });
+}
+
+// Touches ks from each of threads threads, all of which hit. Lru and HashLru
+// reorder their lists on a hit, so must hold a lock to share one policy,
+// whereas Clock and Sieve only set a reference bit.
+template <typename E>
+void hits(const string& name, const vector<int64_t>& ks, size_t threads, size_t ops, bool locked) {
+  E e;
+  for (auto k : ks) {
+    e.touch(k);
+  }
+  mutex m;
+  bench(name + "::touch (hit, " + to_string(threads) + " threads)", threads * ops, [&]{
+    vector<thread> ts;
+    for (size_t t = 0; t < threads; ++t) {
+      ts.emplace_back([&, t]{
+        for (size_t i = 0, j = t * 7919; i < ops; ++i, j += 31) {
+          const auto k = ks[j % ks.size()];
+          if (locked) {
+            lock_guard<mutex> lock(m);
+            e.touch(k);
+          } else {
+            e.touch(k);
+          }
+        }
+      });
+    }
+    for (auto& t : ts) {
+      t.join();
+    }
+    return e.evict();
+  });
+}
+
+// Replays trace through a cache of the given capacity and reports the hit
+// ratio. As in Cache, a new key is touched before making room for it.
+template <typename E>
+void hit_ratio(const string& name, const vector<int64_t>& trace, size_t capacity) {
+  E e;
+  unordered_set<int64_t> resident;
+  size_t hits = 0;
+  for (auto k : trace) {
+    hits += resident.count(k);
+    e.touch(k);
+    resident.insert(k);
+    if (resident.size() > capacity) {
+      const auto v = e.evict();
+      e.erase(v);
+      resident.erase(v);
+    }
+  }
+  cout << left << setw(48) << name
+       << right << setw(10) << fixed << setprecision(2)
+       << (100.0 * hits / trace.size()) << " % hits" << endl;
+}
+
+// n draws from a Zipfian distribution with exponent s over m keys
+vector<int64_t> zipf(size_t n, size_t m, double s) {
+  vector<double> cdf(m);
+  double sum = 0;
+  for (size_t i = 0; i < m; ++i) {
+    cdf[i] = (sum += 1 / pow(i+1, s));
+  }
+  mt19937_64 gen(3);
+  uniform_real_distribution<double> u(0, sum);
+  vector<int64_t> res(n);
+  for (auto& k : res) {
+    k = lower_bound(cdf.begin(), cdf.end(), u(gen)) - cdf.begin();
+  }
+  return res;
+}
+
+// The Zipfian trace, interrupted every so often by a scan of keys which are
+// never seen again
+vector<int64_t> scans(const vector<int64_t>& trace, size_t every, size_t len) {
+  vector<int64_t> res;
+  int64_t cold = -1;
+  for (size_t i = 0; i < trace.size(); ++i) {
+    res.push_back(trace[i]);
+    if (i % every == every-1) {
+      for (size_t j = 0; j < len; ++j) {
+        res.push_back(cold--);
+      }
+    }
+  }
+  return res;
+}
+
+template <typename E>
+void ratios(const string& name, const vector<int64_t>& z, const vector<int64_t>& zs, size_t capacity) {
+  hit_ratio<E>(name + " (zipf)", z, capacity);
+  hit_ratio<E>(name + " (zipf + scans)", zs, capacity);
+}
+
+int main() {
+  const size_t n = 1 << 22;
+  const auto ks = keys(n, 1);
+  const auto misses = keys(n, 2);
+
+  run<Lru<UnorderedStore<int64_t, double>>>("Lru", ks, misses);
+  run<HashLru<UnorderedStore<int64_t, double>>>("HashLru", ks, misses);
+  run<Clock<UnorderedStore<int64_t, double>>>("Clock", ks, misses);
+  run<Sieve<UnorderedStore<int64_t, double>>>("Sieve", ks, misses);
+
+  const auto hot = keys(1 << 16, 3);
+  const size_t ops = 1 << 22;
+  for (size_t threads = 1; threads <= 8; threads *= 2) {
+    hits<Lru<UnorderedStore<int64_t, double>>>("Lru", hot, threads, ops, true);
+    hits<HashLru<UnorderedStore<int64_t, double>>>("HashLru", hot, threads, ops, true);
+    hits<Clock<UnorderedStore<int64_t, double>>>("Clock", hot, threads, ops, false);
+    hits<Sieve<UnorderedStore<int64_t, double>>>("Sieve", hot, threads, ops, false);
+  }
+
+  const auto z = zipf(1 << 22, 1 << 20, 0.99);
+  const auto zs = scans(z, 1 << 16, 1 << 15);
+  const size_t capacity = 1 << 14;
+  ratios<Lru<UnorderedStore<int64_t, double>>>("Lru", z, zs, capacity);
+  ratios<Clock<UnorderedStore<int64_t, double>>>("Clock", z, zs, capacity);
+  ratios<Sieve<UnorderedStore<int64_t, double>>>("Sieve", z, zs, capacity);
+  ratios<Arc<UnorderedStore<int64_t, double>>>("Arc", z, zs, capacity);
+  ratios<TwoQ<UnorderedStore<int64_t, double>>>("TwoQ", z, zs, capacity);
+
+  return 0;
+}
@@ -0,0 +1,95 @@
+#include <cstdint>
+#include <cstdlib>
+#include "include/multi.h"
+#include "include/redis.h"
+#include "tools/bench.h"
+
+using namespace binder;
+using namespace std;
+
+// Usage: redis_bench [keys] [host] [port]
+int main(int argc, char** argv) {
+  const size_t n = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1000000;
+  const string host = argc > 2 ? argv[2] : "localhost";
+  const unsigned int port = argc > 3 ? atoi(argv[3]) : 6379;
+
+  RedisStore<int64_t, double> s(host, port);
+  if (!s.is_connected()) {
+    cerr << "Unable to connect to " << host << ":" << port << endl;
+    return 1;
+  }
+  const auto ks = keys(n);
+
+  s.clear();
+  bench("RedisStore::put", n, [&]{
+    for (auto k : ks) {
+      s.put(make_pair(k, (double)k));
+    }
+    return s.size();
+  });
+
+  s.clear();
+  bench("RedisStore::pipeline().put", n, [&]{
+    auto p = s.pipeline();
+    for (auto k : ks) {
+      p.put(make_pair(k, (double)k));
+    }
+    p.flush();
+    return s.size();
+  });
+
+  s.clear();
+  bench("multi_put(RedisStore) (1024 per batch)", n, [&]{
+    vector<pair<int64_t, double>> vs;
+    for (size_t i = 0; i < n; i += 1024) {
+      vs.clear();
+      for (size_t j = i; j < min(n, i + 1024); ++j) {
+        vs.push_back(make_pair(ks[j], (double)ks[j]));
+      }
+      multi_put(s, vs.begin(), vs.end());
+    }
+    return s.size();
+  });
+
+  bench("RedisStore::get", n, [&]{
+    double sum = 0;
+    for (auto k : ks) {
+      sum += s.get(k);
+    }
+    return sum;
+  });
+  bench("RedisStore::pipeline().get", n, [&]{
+    auto p = s.pipeline();
+    vector<future<double>> fs;
+    fs.reserve(n);
+    for (auto k : ks) {
+      fs.push_back(p.get(k));
+    }
+    p.flush();
+    double sum = 0;
+    for (auto& f : fs) {
+      sum += f.get();
+    }
+    return sum;
+  });
+
+  // The same round trips with keys and values stored as raw bytes
+  RedisStore<int64_t, double, Binary<int64_t, double>> b(host, port);
+  b.clear();
+  bench("RedisStore<Binary>::put", n, [&]{
+    for (auto k : ks) {
+      b.put(make_pair(k, (double)k));
+    }
+    return b.size();
+  });
+  bench("RedisStore<Binary>::get", n, [&]{
+    double sum = 0;
+    for (auto k : ks) {
+      sum += b.get(k);
+    }
+    return sum;
+  });
+
+  s.clear();
+  return 0;
+}
@@ -0,0 +1,63 @@
+#include <cstdint>
+#include <mutex>
+#include "include/flat.h"
+#include "include/sharded.h"
+#include "include/store.h"
+#include "tools/bench.h"
+
+using namespace binder;
+using namespace std;
+
+// The status quo: one store behind one lock
+template <typename S>
+class Locked {
+  public:
+    typename S::v_type get(const typename S::k_type& k) {
+      lock_guard<mutex> lock(m_);
+      return s_.get(k);
+    }
+    void put(const typename S::value_type& v) {
+      lock_guard<mutex> lock(m_);
+      s_.put(v);
+    }
+
+  private:
+    mutex m_;
+    S s_;
+};
+
+// Each thread performs ops operations, one in ten of which is a put
+template <typename S>
+void run(const string& name, S& s, const vector<int64_t>& ks, size_t threads, size_t ops) {
+  for (auto k : ks) {
+    s.put(make_pair(k, (double)k));
+  }
+  bench_threads(name + " (" + to_string(threads) + " threads)", threads, ops, [&](size_t t){
+    double sum = 0;
+    for (size_t i = 0, j = t * 7919; i < ops; ++i, j += 31) {
+      const auto k = ks[j % ks.size()];
+      if (i % 10 == 0) {
+        s.put(make_pair(k, (double)i));
+      } else {
+        sum += s.get(k);
+      }
+    }
+    return sum;
+  });
+}
+
+int main() {
+  const auto ks = keys(1 << 20);
+  const size_t ops = 1 << 20;
+
+  for (size_t threads = 1; threads <= 32; threads *= 2) {
+    Locked<UnorderedStore<int64_t, double>> s1;
+    run("Locked<UnorderedStore>", s1, ks, threads, ops);
+    ShardedStore<int64_t, double> s2(256);
+    run("ShardedStore<UnorderedStore>", s2, ks, threads, ops);
+    ShardedStore<int64_t, double, FlatStore<int64_t, double>> s3(256);
+    run("ShardedStore<FlatStore>", s3, ks, threads, ops);
+  }
+
+  return 0;
+}